@@ -0,0 +1,13 @@
+#!/bin/bash
+# Usage: atlas_embed.sh input_ttf pixel_height chars
+
+set -e
+
+fontname="$(basename ${1%.*})"
+fontname="${fontname//[^[:alnum:]]/_}"
+fontname="${fontname,,}"
+name="${fontname}_$2_atlas"
+
+cc -O2 -I"$(dirname $0)/../src" -o "./atlas_gen" "$(dirname $0)/atlas_gen.c" -lm
+./atlas_gen "$1" "$2" "$name" "$3" > "${name}.h"
+rm "./atlas_gen"
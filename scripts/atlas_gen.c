@@ -0,0 +1,141 @@
+// atlas_gen.c
+// Pre-rasterizes a set of glyphs into a 2bpp atlas header (struct TTF_atlas).
+// Built and run by atlas_embed.sh, uses the same stb_truetype as the firmware.
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "ext/stb_truetype.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+static unsigned char* read_file(const char* filename)
+{
+    FILE* f = fopen(filename, "rb");
+    if (!f)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    unsigned char* buf = malloc(size);
+    if (fread(buf, 1, size, f) != (size_t) size) {
+        free(buf);
+        buf = NULL;
+    }
+
+    fclose(f);
+    return buf;
+}
+
+static int to_64ths(float x)
+{
+    return (int) lroundf(x * 64.f);
+}
+
+static void write_bytes(const unsigned char* data, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (i % 16 == 0)
+            printf("    ");
+        printf("0x%02x,%s", data[i], (i % 16 == 15 || i == n - 1) ? "\n" : " ");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 5) {
+        fprintf(stderr, "Usage: %s [ttf] [pixel height] [name] [chars]\n", argv[0]);
+        return 1;
+    }
+
+    const float line_height = (float) atof(argv[2]);
+    const char* name = argv[3];
+    const char* chars = argv[4];
+    const int n_chars = (int) strlen(chars);
+
+    const unsigned char* ttf = read_file(argv[1]);
+    stbtt_fontinfo font;
+    if (!ttf || !stbtt_InitFont(&font, ttf, 0)) {
+        fprintf(stderr, "Could not load %s\n", argv[1]);
+        return 1;
+    }
+
+    const float scale = stbtt_ScaleForPixelHeight(&font, line_height);
+    int ascent, descent, line_gap;
+    stbtt_GetFontVMetrics(&font, &ascent, &descent, &line_gap);
+
+    printf("// generated by atlas_embed.sh, %s at %g px\n\n", argv[1], line_height);
+
+    // bitmaps
+    int offsets[256];
+    int offset = 0;
+
+    printf("static const uint8_t %s_bitmap[] = {\n", name);
+    for (int i = 0; i < n_chars; i++) {
+        const int glyph = stbtt_FindGlyphIndex(&font, chars[i]);
+
+        int w, h, x0, y0;
+        unsigned char* bitmap = stbtt_GetGlyphBitmapSubpixel(&font, scale, scale, 0.f, 0.f,
+                glyph, &w, &h, &x0, &y0);
+
+        // 2bpp, 4 px per byte, MSB first
+        const int size = (w * h + 3) / 4;
+        unsigned char* packed = calloc(size + 1, 1);
+        for (int j = 0; j < w * h; j++)
+            packed[j / 4] |= (bitmap[j] >> 6) << (6 - 2 * (j % 4));
+
+        printf("    // '%c'\n", chars[i]);
+        write_bytes(packed, size);
+
+        offsets[i] = offset;
+        offset += size;
+
+        free(packed);
+        stbtt_FreeBitmap(bitmap, NULL);
+    }
+    printf("};\n\n");
+
+    // glyph metrics
+    printf("static const struct TTF_atlas_glyph %s_glyphs[%d] = {\n", name, n_chars);
+    for (int i = 0; i < n_chars; i++) {
+        const int glyph = stbtt_FindGlyphIndex(&font, chars[i]);
+
+        int advance, left_side_bearing;
+        stbtt_GetGlyphHMetrics(&font, glyph, &advance, &left_side_bearing);
+
+        int x1, y1, x2, y2;
+        stbtt_GetGlyphBitmapBoxSubpixel(&font, glyph, scale, scale, 0.f, 0.f, &x1, &y1, &x2, &y2);
+
+        printf("    { %5d, %5d, %4d, %3d, %3d, %6d }, // '%c'\n",
+                to_64ths(left_side_bearing * scale), to_64ths(advance * scale),
+                y1, x2 - x1, y2 - y1, offsets[i], chars[i]);
+    }
+    printf("};\n\n");
+
+    // kerning, [left][right]
+    printf("static const int16_t %s_kern[%d] = {\n", name, n_chars * n_chars);
+    for (int i = 0; i < n_chars; i++) {
+        printf("    ");
+        for (int j = 0; j < n_chars; j++) {
+            const int kern = stbtt_GetCodepointKernAdvance(&font, chars[i], chars[j]);
+            printf("%d,%s", to_64ths(kern * scale), (j == n_chars - 1) ? "\n" : " ");
+        }
+    }
+    printf("};\n\n");
+
+    printf("const struct TTF_atlas %s = {\n", name);
+    printf("    \"%s\", // chars\n", chars);
+    printf("    %d, // number of chars\n", n_chars);
+    printf("    %d, // ascent, 1/64 px\n", to_64ths(ascent * scale));
+    printf("    %s_glyphs,\n", name);
+    printf("    %s_kern,\n", name);
+    printf("    %s_bitmap\n", name);
+    printf("};\n");
+
+    return 0;
+}
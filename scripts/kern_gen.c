@@ -0,0 +1,71 @@
+// kern_gen.c
+// Dumps a dense printable ASCII kerning matrix (font units) for TTF_set_kerning.
+// Built and run by ttf_embed.sh on the subset font, uses the same stb_truetype
+// as the firmware.
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "ext/stb_truetype.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+
+#define ASCII_FIRST     0x20
+#define ASCII_COUNT     95
+
+static unsigned char* read_file(const char* filename)
+{
+    FILE* f = fopen(filename, "rb");
+    if (!f)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    unsigned char* buf = malloc(size);
+    if (fread(buf, 1, size, f) != (size_t) size) {
+        free(buf);
+        buf = NULL;
+    }
+
+    fclose(f);
+    return buf;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s [ttf] [name]\n", argv[0]);
+        return 1;
+    }
+
+    const char* name = argv[2];
+
+    const unsigned char* ttf = read_file(argv[1]);
+    stbtt_fontinfo font;
+    if (!ttf || !stbtt_InitFont(&font, ttf, 0)) {
+        fprintf(stderr, "Could not load %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("// generated by ttf_embed.sh\n");
+    printf("// font units, [left - 0x%02x][right - 0x%02x]\n\n", ASCII_FIRST, ASCII_FIRST);
+
+    printf("const int16_t %s[%d] = {\n", name, ASCII_COUNT * ASCII_COUNT);
+    for (int i = 0; i < ASCII_COUNT; i++) {
+        printf("    // '%c'\n", ASCII_FIRST + i);
+
+        for (int j = 0; j < ASCII_COUNT; j++) {
+            const int kern = stbtt_GetCodepointKernAdvance(&font, ASCII_FIRST + i, ASCII_FIRST + j);
+
+            if (j % 19 == 0)
+                printf("    ");
+            printf("%d,%s", kern, (j % 19 == 18) ? "\n" : " ");
+        }
+    }
+    printf("};\n");
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+# lut_pack.py
+# packs a 233 byte waveform table, laid out as LUT_ALL in epd4in2_V2.cpp, into a file
+# the terminal's 'load waveform' accepts. The table is either raw bytes or text holding
+# its values as hex, e.g. copied out of the C array.
+
+import re
+import struct
+import zlib
+
+LUT_BYTES = 233
+
+
+def read_table(filename):
+    data = open(filename, 'rb').read()
+    if len(data) != LUT_BYTES:
+        data = bytes(int(x, 16) for x in re.findall(rb'0x([0-9a-fA-F]{1,2})', data))
+
+    if len(data) != LUT_BYTES:
+        raise ValueError(f'{filename}: {len(data)} bytes, expected {LUT_BYTES}')
+    return data
+
+def pack(table):
+    # magic, version, 3 reserved, table, CRC-32 of everything before it
+    body = b'EPDL' + bytes([1, 0, 0, 0]) + table
+    return body + struct.pack('<I', zlib.crc32(body))
+
+def send(port, packed):
+    import serial
+
+    with serial.Serial(port, 115200, timeout=15) as ser:
+        # the terminal has to be open already, a bare \r ends the command line
+        ser.write(b'load waveform\r')
+        while True:
+            line = ser.readline().decode(errors='replace')
+            if not line:
+                raise TimeoutError('no reply')
+            print(line, end='')
+            if 'Send the' in line:
+                break
+
+        ser.write(packed)
+        print(ser.readline().decode(errors='replace'), end='')
+
+if __name__ == "__main__":
+    import sys
+    import os.path
+
+    if len(sys.argv) not in (2, 3):
+        print(f'Usage: {sys.argv[0]} [table] [serial port]')
+        exit()
+
+    packed = pack(read_table(sys.argv[1]))
+    out_filename = os.path.splitext(os.path.basename(sys.argv[1]))[0] + '.lut'
+    open(out_filename, 'wb').write(packed)
+    print(f'Saved {out_filename}')
+
+    if len(sys.argv) == 3:
+        send(sys.argv[2], packed)
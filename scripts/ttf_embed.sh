@@ -10,4 +10,11 @@ fontname="${fontname,,}"
 # pip install fonttools
 pyftsubset "$1" --output-file="./temp.tff" --unicodes=U+0020-007E
 xxd -i -n "$fontname" "./temp.tff" "${fontname}.h"
+
+# ascii kerning matrix, from the same subset
+kernname="${fontname%_ttf}_kern"
+cc -O2 -I"$(dirname $0)/../src" -o "./kern_gen" "$(dirname $0)/kern_gen.c" -lm
+./kern_gen "./temp.tff" "$kernname" > "${kernname}.h"
+rm "./kern_gen"
+
 rm "./temp.tff"
\ No newline at end of file
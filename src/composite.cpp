@@ -0,0 +1,490 @@
+// composite.cpp
+
+#include "composite.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+// 4x4 bayer matrix, each entry m as the threshold 16 * m + 8
+const uint8_t composite_bayer_4x4[16] = {
+      8, 136,  40, 168,
+    200,  72, 232, 104,
+     56, 184,  24, 152,
+    248, 120, 216,  88,
+};
+
+void composite_fill_blank(const struct composite_fb* fb)
+{
+    assert(fb);
+
+    const int bytes = fb->h * (fb->w * fb->bpp / 8);
+    memset(fb->buf, (fb->polarity == COMPOSITE_INK_ZEROS) ? 0xFF : 0x00, bytes);
+}
+
+// combines ink into the pixels of a destination byte selected by mask,
+// in the ink-is-set view of the stored bits
+static inline void blend(uint8_t* out, uint8_t ink, uint8_t mask, int polarity, int op)
+{
+    const uint8_t flip = (polarity == COMPOSITE_INK_ZEROS) ? 0xFF : 0x00;
+    uint8_t dst = *out ^ flip;
+
+    switch (op) {
+    case COMPOSITE_OP_OR:       dst |= ink;                             break;
+    case COMPOSITE_OP_CLEAR:    dst &= ~ink;                            break;
+    case COMPOSITE_OP_XOR:      dst ^= ink;                             break;
+    case COMPOSITE_OP_REPLACE:  dst = (dst & ~mask) | (ink & mask);     break;
+    }
+
+    *out = dst ^ flip;
+}
+
+static inline int imin(int a, int b)
+{
+    return (a < b) ? a : b;
+}
+
+static inline int imax(int a, int b)
+{
+    return (a > b) ? a : b;
+}
+
+// source / destination window left after clipping to the framebuffer
+struct clip
+{
+    int i0, i1;     // source rows
+    int j0, j1;     // source columns
+};
+
+static int clip_to_fb(const struct composite_fb* fb, int x, int y, int w, int h, struct clip* c)
+{
+    c->i0 = imax(0, -y);
+    c->i1 = imin(h, fb->h - y);
+    c->j0 = imax(0, -x);
+    c->j1 = imin(w, fb->w - x);
+
+    return (c->i0 < c->i1) && (c->j0 < c->j1);
+}
+
+
+
+// scalar reference, one pixel at a time
+
+static void plot_scalar(const struct composite_fb* fb, int x, int y, uint8_t pixel, int op)
+{
+    const int ppb = 8 / fb->bpp;
+    const int shift = (x % ppb) * fb->bpp;
+    const uint8_t mask = (uint8_t) (0xFF00 >> fb->bpp);
+
+    uint8_t* out = &fb->buf[y * (fb->w / ppb) + x / ppb];
+    blend(out, pixel >> shift, mask >> shift, fb->polarity, op);
+}
+
+// atkinson over the whole clipped window at once, needs the heap
+static void atkinson_scalar(const struct composite_fb* fb, int x, int y, int w,
+        const uint8_t* in_8bpp, int op, const struct clip* c)
+{
+    const int n = c->j1 - c->j0;
+    const int stride = n + 3;
+    int16_t* error = (int16_t*) calloc((size_t) (c->i1 - c->i0 + 2) * stride, sizeof(int16_t));
+    if (!error)
+        return;
+
+    for (int i = c->i0; i < c->i1; i++) {
+        int16_t* row = &error[(i - c->i0) * stride + 1];
+
+        for (int j = 0; j < n; j++) {
+            const int value = in_8bpp[i * w + c->j0 + j] + row[j];
+            const int out = (value >= 0x80) ? 0xFF : 0x00;
+            const int16_t e = (int16_t) ((value - out) / 8);
+
+            row[j + 1] += e;
+            row[j + 2] += e;
+            row[stride + j - 1] += e;
+            row[stride + j] += e;
+            row[stride + j + 1] += e;
+            row[2 * stride + j] += e;
+
+            plot_scalar(fb, x + c->j0 + j, y + i, composite_to_1bpp((uint8_t) out), op);
+        }
+    }
+
+    free(error);
+}
+
+void composite_8bpp_to_1bpp_scalar(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op)
+{
+    struct clip c;
+    if (!clip_to_fb(fb, x, y, w, h, &c))
+        return;
+
+    int dither = fb->dither;
+    if (dither == COMPOSITE_DITHER_ATKINSON && c.j1 - c.j0 > COMPOSITE_DITHER_MAX_W)
+        dither = COMPOSITE_DITHER_BAYER;
+
+    if (dither == COMPOSITE_DITHER_ATKINSON) {
+        atkinson_scalar(fb, x, y, w, in_8bpp, op, &c);
+        return;
+    }
+
+    for (int i = c.i0; i < c.i1; i++) {
+        for (int j = c.j0; j < c.j1; j++) {
+            const uint8_t coverage = in_8bpp[i * w + j];
+            const uint8_t pixel = (dither == COMPOSITE_DITHER_BAYER) ?
+                composite_to_1bpp_bayer(coverage, x + j, y + i) : composite_to_1bpp(coverage);
+            plot_scalar(fb, x + j, y + i, pixel, op);
+        }
+    }
+}
+
+void composite_8bpp_to_2bpp_scalar(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op)
+{
+    struct clip c;
+    if (!clip_to_fb(fb, x, y, w, h, &c))
+        return;
+
+    for (int i = c.i0; i < c.i1; i++) {
+        for (int j = c.j0; j < c.j1; j++)
+            plot_scalar(fb, x + j, y + i, composite_to_2bpp(in_8bpp[i * w + j]), op);
+    }
+}
+
+static uint8_t min_level(uint8_t a, uint8_t b)
+{
+    return (a < b) ? a : b;
+}
+
+void composite_8bpp_to_2bpp_level_scalar(const struct composite_fb* fb, int x, int y, int w, int h,
+    const uint8_t* in_8bpp, uint8_t level, int op)
+{
+    struct clip c;
+    if (!clip_to_fb(fb, x, y, w, h, &c))
+        return;
+
+    for (int i = c.i0; i < c.i1; i++) {
+        for (int j = c.j0; j < c.j1; j++)
+            plot_scalar(fb, x + j, y + i, composite_to_2bpp(min_level(in_8bpp[i * w + j], level)), op);
+    }
+}
+
+
+
+// word kernels, 4 source pixels per load, specialized per format / polarity / op
+// by templates so the inner loops carry no runtime branches. both targets
+// (xtensa, x86) are little endian, so pixel 0 is the low byte of the word.
+
+static inline uint32_t load_32(const uint8_t* in)
+{
+    uint32_t v;
+    memcpy(&v, in, sizeof(v));  // unaligned safe, a single load where allowed
+    return v;
+}
+
+// msb of 4 pixels to a nibble, pixel 0 in bit 3. the multiply moves each bit
+// into bits 24..27 without any partial products colliding.
+static inline uint32_t pack_1bpp(uint32_t v)
+{
+    const uint32_t bits = (v >> 7) & 0x01010101;
+    return ((bits * 0x08040201) >> 24) & 0x0F;
+}
+
+// 2-bit levels (0..3, one per byte) of 4 pixels to a 2bpp byte, pixel 0 in the
+// top bits, with the same bit swap as composite_to_2bpp.
+static inline uint8_t pack_2bpp(uint32_t levels)
+{
+    const uint32_t hi = levels & 0x01010101;           // level bit 0 is the code's msb
+    const uint32_t lo = (levels >> 1) & 0x01010101;
+    const uint32_t packed = ((hi * 0x80200802) & 0xAA000000) | ((lo * 0x40100401) & 0x55000000);
+    return (uint8_t) (packed >> 24);
+}
+
+// per byte min of 2-bit levels and a broadcast clamp
+static inline uint32_t min_levels(uint32_t levels, uint32_t clamp)
+{
+    const uint32_t ge = (((levels | 0x80808080) - clamp) >> 7) & 0x01010101;
+    const uint32_t mask = ge * 0xFF;
+    return (clamp & mask) | (levels & ~mask);
+}
+
+// packers turn one destination byte worth of 8bpp source pixels into packed ink.
+// one is built per row, so anything that depends on position is set up once.
+
+// 1bpp, thresholded at half coverage
+struct Threshold1
+{
+    static const int bpp = 1;
+    static const int pixels_per_byte = 8;
+
+    Threshold1(int /* x */, int /* y */, uint32_t /* clamp */) {}
+
+    inline uint8_t pack(const uint8_t* in) const
+    {
+        return (uint8_t) ((pack_1bpp(load_32(in)) << 4) | pack_1bpp(load_32(in + 4)));
+    }
+};
+
+// 1bpp, ordered dither. a group is 8 pixels, so every group in a row starts on
+// the same matrix column and one row of thresholds serves them all.
+struct Bayer1
+{
+    static const int bpp = 1;
+    static const int pixels_per_byte = 8;
+
+    uint8_t thresholds[8];
+
+    Bayer1(int x, int y, uint32_t /* clamp */)
+    {
+        for (int j = 0; j < 8; j++)
+            thresholds[j] = composite_bayer_4x4[(y & 3) * 4 + ((x + j) & 3)];
+    }
+
+    inline uint8_t pack(const uint8_t* in) const
+    {
+        uint8_t ink = 0;
+        for (int j = 0; j < 8; j++)
+            ink |= (uint8_t) ((in[j] > thresholds[j]) << (7 - j));
+        return ink;
+    }
+};
+
+// 2bpp levels, clamped to a broadcast 2-bit level if asked
+template <bool Clamp>
+struct Levels2
+{
+    static const int bpp = 2;
+    static const int pixels_per_byte = 4;
+
+    uint32_t clamp;
+
+    Levels2(int /* x */, int /* y */, uint32_t clamp) : clamp(clamp) {}
+
+    inline uint8_t pack(const uint8_t* in) const
+    {
+        const uint32_t levels = (load_32(in) >> 6) & 0x03030303;
+        return pack_2bpp(Clamp ? min_levels(levels, clamp) : levels);
+    }
+};
+
+// blend() with polarity and op folded at compile time
+template <int Polarity, int Op>
+static inline void blend_op(uint8_t* out, uint8_t ink, uint8_t mask)
+{
+    const uint8_t flip = (Polarity == COMPOSITE_INK_ZEROS) ? 0xFF : 0x00;
+    uint8_t dst = *out ^ flip;
+
+    switch (Op) {
+    case COMPOSITE_OP_OR:       dst |= ink;                             break;
+    case COMPOSITE_OP_CLEAR:    dst &= ~ink;                            break;
+    case COMPOSITE_OP_XOR:      dst ^= ink;                             break;
+    case COMPOSITE_OP_REPLACE:  dst = (dst & ~mask) | (ink & mask);     break;
+    }
+
+    *out = dst ^ flip;
+}
+
+// composites n source pixels to row y starting at pixel x. groups are packed
+// byte aligned to the source and shifted into place through a 16-bit window,
+// so every destination byte is read and written once whatever the alignment.
+// a second window carries which pixels the source covers, only replace reads it.
+template <typename Packer, int Polarity, int Op>
+static void composite_row(uint8_t* row, int x, int y, const uint8_t* in, int n, uint32_t clamp)
+{
+    const int bpp = Packer::bpp;
+    const int ppb = Packer::pixels_per_byte;
+    const int shift = (x % ppb) * bpp;
+    const int n_groups = n / ppb;
+    const int n_bytes = ((x % ppb) + n + ppb - 1) / ppb;
+    const Packer packer(x, y, clamp);
+
+    uint8_t* out = &row[x / ppb];
+    uint32_t window = 0;
+    uint32_t mask_window = 0;
+
+    for (int k = 0; k < n_bytes; k++) {
+        uint8_t ink = 0;
+        uint8_t mask = 0;
+        if (k < n_groups) {
+            ink = packer.pack(&in[k * ppb]);
+            mask = 0xFF;
+        } else if (k == n_groups && n % ppb) {
+            // partial last group, zero padded so nothing past the source is read
+            uint8_t tail[8] = { 0 };
+            memcpy(tail, &in[k * ppb], n % ppb);
+            ink = packer.pack(tail);
+            mask = (uint8_t) (0xFF00 >> ((n % ppb) * bpp));
+        }
+
+        window = (window << 8) | ink;
+        if (Op == COMPOSITE_OP_REPLACE)
+            mask_window = (mask_window << 8) | mask;
+
+        blend_op<Polarity, Op>(out++, (uint8_t) (window >> shift), (uint8_t) (mask_window >> shift));
+    }
+}
+
+template <typename Packer, int Polarity, int Op>
+static void composite_kernel(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, uint32_t clamp)
+{
+    struct clip c;
+    if (!clip_to_fb(fb, x, y, w, h, &c))
+        return;
+
+    const int row_bytes = fb->w * Packer::bpp / 8;
+
+    for (int i = c.i0; i < c.i1; i++)
+        composite_row<Packer, Polarity, Op>(&fb->buf[(y + i) * row_bytes], x + c.j0, y + i,
+            &in_8bpp[i * w + c.j0], c.j1 - c.j0, clamp);
+}
+
+// picks the specialization for the runtime polarity and op
+template <typename Packer>
+static void composite_dispatch(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, uint32_t clamp, int op)
+{
+    typedef void (*Kernel)(const struct composite_fb*, int, int, int, int, const uint8_t*, uint32_t);
+
+    static const Kernel kernels[2][4] = {
+        {
+            composite_kernel<Packer, COMPOSITE_INK_ONES, COMPOSITE_OP_OR>,
+            composite_kernel<Packer, COMPOSITE_INK_ONES, COMPOSITE_OP_CLEAR>,
+            composite_kernel<Packer, COMPOSITE_INK_ONES, COMPOSITE_OP_XOR>,
+            composite_kernel<Packer, COMPOSITE_INK_ONES, COMPOSITE_OP_REPLACE>,
+        },
+        {
+            composite_kernel<Packer, COMPOSITE_INK_ZEROS, COMPOSITE_OP_OR>,
+            composite_kernel<Packer, COMPOSITE_INK_ZEROS, COMPOSITE_OP_CLEAR>,
+            composite_kernel<Packer, COMPOSITE_INK_ZEROS, COMPOSITE_OP_XOR>,
+            composite_kernel<Packer, COMPOSITE_INK_ZEROS, COMPOSITE_OP_REPLACE>,
+        },
+    };
+
+    assert(fb->bpp == Packer::bpp);
+    assert(fb->polarity == COMPOSITE_INK_ONES || fb->polarity == COMPOSITE_INK_ZEROS);
+    assert(op >= COMPOSITE_OP_OR && op <= COMPOSITE_OP_REPLACE);
+
+    kernels[fb->polarity][op](fb, x, y, w, h, in_8bpp, clamp);
+}
+
+// error diffusion rows, static so compositing never touches the heap. offset by
+// one column so the pixel down-left of the first needs no special case.
+static int16_t  error_rows[3][COMPOSITE_DITHER_MAX_W + 3];
+static uint8_t  diffused_row[COMPOSITE_DITHER_MAX_W];
+
+// diffuses a row at a time into black / white 8bpp, which then goes through the
+// thresholding kernel like any other source
+static void composite_atkinson(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op)
+{
+    struct clip c;
+    if (!clip_to_fb(fb, x, y, w, h, &c))
+        return;
+
+    const int n = c.j1 - c.j0;
+    if (n > COMPOSITE_DITHER_MAX_W) {
+        composite_dispatch<Bayer1>(fb, x, y, w, h, in_8bpp, 0, op);
+        return;
+    }
+
+    memset(error_rows, 0, sizeof(error_rows));
+    int16_t* cur = &error_rows[0][1];
+    int16_t* next = &error_rows[1][1];
+    int16_t* next2 = &error_rows[2][1];
+
+    for (int i = c.i0; i < c.i1; i++) {
+        const uint8_t* in = &in_8bpp[i * w + c.j0];
+
+        for (int j = 0; j < n; j++) {
+            const int value = in[j] + cur[j];
+            const int out = (value >= 0x80) ? 0xFF : 0x00;
+            const int16_t error = (int16_t) ((value - out) / 8);
+
+            diffused_row[j] = (uint8_t) out;
+            cur[j + 1] += error;
+            cur[j + 2] += error;
+            next[j - 1] += error;
+            next[j] += error;
+            next[j + 1] += error;
+            next2[j] += error;
+        }
+
+        composite_dispatch<Threshold1>(fb, x + c.j0, y + i, n, 1, diffused_row, 0, op);
+
+        int16_t* done = cur;
+        cur = next;
+        next = next2;
+        next2 = done;
+        memset(&next2[-1], 0, (n + 3) * sizeof(int16_t));
+    }
+}
+
+void composite_8bpp_to_1bpp_word(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op)
+{
+    switch (fb->dither) {
+    case COMPOSITE_DITHER_BAYER:
+        composite_dispatch<Bayer1>(fb, x, y, w, h, in_8bpp, 0, op);
+        break;
+    case COMPOSITE_DITHER_ATKINSON:
+        composite_atkinson(fb, x, y, w, h, in_8bpp, op);
+        break;
+    default:
+        composite_dispatch<Threshold1>(fb, x, y, w, h, in_8bpp, 0, op);
+        break;
+    }
+}
+
+void composite_8bpp_to_2bpp_word(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op)
+{
+    composite_dispatch<Levels2<false> >(fb, x, y, w, h, in_8bpp, 0, op);
+}
+
+void composite_8bpp_to_2bpp_level_word(const struct composite_fb* fb, int x, int y, int w, int h,
+    const uint8_t* in_8bpp, uint8_t level, int op)
+{
+    // quantizing is monotonic, so clamping levels matches clamping coverage
+    composite_dispatch<Levels2<true> >(fb, x, y, w, h, in_8bpp, (uint32_t) (level >> 6) * 0x01010101, op);
+}
+
+
+
+void composite_8bpp_to_1bpp(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op)
+{
+    assert(fb->bpp == 1);
+
+#if COMPOSITE_KERNEL == COMPOSITE_KERNEL_WORD
+    composite_8bpp_to_1bpp_word(fb, x, y, w, h, in_8bpp, op);
+#else
+    composite_8bpp_to_1bpp_scalar(fb, x, y, w, h, in_8bpp, op);
+#endif
+}
+
+void composite_8bpp_to_2bpp(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op)
+{
+    assert(fb->bpp == 2);
+
+#if COMPOSITE_KERNEL == COMPOSITE_KERNEL_WORD
+    composite_8bpp_to_2bpp_word(fb, x, y, w, h, in_8bpp, op);
+#else
+    composite_8bpp_to_2bpp_scalar(fb, x, y, w, h, in_8bpp, op);
+#endif
+}
+
+void composite_8bpp_to_2bpp_level(const struct composite_fb* fb, int x, int y, int w, int h,
+    const uint8_t* in_8bpp, uint8_t level, int op)
+{
+    assert(fb->bpp == 2);
+
+#if COMPOSITE_KERNEL == COMPOSITE_KERNEL_WORD
+    composite_8bpp_to_2bpp_level_word(fb, x, y, w, h, in_8bpp, level, op);
+#else
+    composite_8bpp_to_2bpp_level_scalar(fb, x, y, w, h, in_8bpp, level, op);
+#endif
+}
\ No newline at end of file
@@ -11,14 +11,90 @@ extern "C" {
 
 
 
-void composite_8bpp_to_1bpp(uint8_t* out_1bpp, int x, int y, int w, int h,
-        int stride, const uint8_t* in_8bpp);
+// packed destination, rows of w pixels msb first
+struct composite_fb
+{
+    uint8_t*    buf;
+    int         w;
+    int         h;
+    int         bpp;        // 1 or 2
+    int         polarity;   // COMPOSITE_INK_*
+    int         dither;     // COMPOSITE_DITHER_*, 1bpp only
+};
 
-void composite_8bpp_to_2bpp(uint8_t* out_2bpp, int x, int y, int w, int h,
-        int stride, const uint8_t* in_8bpp);
+#define COMPOSITE_INK_ONES      0       // ink is set bits, cleared memory is blank
+#define COMPOSITE_INK_ZEROS     1       // ink is cleared bits, the panel's native encoding
 
-void composite_8bpp_to_2bpp_level(uint8_t* out_2bpp, int x, int y, int w, int h,
-        int stride, const uint8_t* in_8bpp, uint8_t level);
+#define COMPOSITE_DITHER_NONE       0       // threshold at half coverage
+#define COMPOSITE_DITHER_BAYER      1       // 4x4 ordered
+#define COMPOSITE_DITHER_ATKINSON   2       // error diffusion, 6/8 of the error passed on
+#define COMPOSITE_DITHER_MAX_W      400     // widest window diffused, wider falls back to bayer
+
+// how source ink combines with the framebuffer, in ink terms whatever the polarity
+#define COMPOSITE_OP_OR         0       // add ink
+#define COMPOSITE_OP_CLEAR      1       // erase where the source has ink
+#define COMPOSITE_OP_XOR        2       // toggle where the source has ink
+#define COMPOSITE_OP_REPLACE    3       // overwrite the whole window, blanks included
+
+// fills the framebuffer with blank (white) pixels
+void composite_fill_blank(const struct composite_fb* fb);
+
+// 8bpp coverage to a 1bpp / 2bpp pixel in the most significant bits
+static inline uint8_t composite_to_1bpp(uint8_t x)
+{
+    return (x & 0x80);
+}
+
+// ordered dither thresholds, row major
+extern const uint8_t composite_bayer_4x4[16];
+
+// 8bpp coverage at pixel px / py to a 1bpp pixel in the msb, ordered dithered
+static inline uint8_t composite_to_1bpp_bayer(uint8_t x, int px, int py)
+{
+    return (x > composite_bayer_4x4[(py & 3) * 4 + (px & 3)]) ? 0x80 : 0x00;
+}
+
+static inline uint8_t composite_to_2bpp(uint8_t x)
+{
+    x &= 0xC0;
+    x |= (x & 0x80) >> 2;
+    x <<= 1;
+    return x;
+}
+
+// COMPOSITE_KERNEL picks the kernel behind the unsuffixed entry points
+#define COMPOSITE_KERNEL_SCALAR 0       // one pixel at a time, the reference
+#define COMPOSITE_KERNEL_WORD   1       // 4 pixels per 32-bit load
+
+#ifndef COMPOSITE_KERNEL
+#define COMPOSITE_KERNEL        COMPOSITE_KERNEL_WORD
+#endif
+
+// w x h 8bpp source placed at any pixel x / y, clipped to the framebuffer
+void composite_8bpp_to_1bpp(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op);
+
+void composite_8bpp_to_2bpp(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op);
+
+void composite_8bpp_to_2bpp_level(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, uint8_t level, int op);
+
+// kernels behind the entry points, exposed for benchmarks and equivalence checks
+void composite_8bpp_to_1bpp_scalar(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op);
+void composite_8bpp_to_1bpp_word(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op);
+
+void composite_8bpp_to_2bpp_scalar(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op);
+void composite_8bpp_to_2bpp_word(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, int op);
+
+void composite_8bpp_to_2bpp_level_scalar(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, uint8_t level, int op);
+void composite_8bpp_to_2bpp_level_word(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in_8bpp, uint8_t level, int op);
 
 
 
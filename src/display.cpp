@@ -0,0 +1,694 @@
+// display.cpp
+
+#include "display.hpp"
+
+#include "epd/epd4in2_V2.h"
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <driver/spi_master.h>
+
+
+
+namespace paper {
+
+static constexpr int        STRIDE              = EPD_WIDTH / 8;
+static constexpr int        PLANE_BYTES         = STRIDE * EPD_HEIGHT;
+static constexpr int        MAX_TRANSACTIONS    = 16;
+static constexpr int        RECT_OVERHEAD_BYTES = 16;       // window commands sent per partial rect
+static constexpr int        TASK_STACK_BYTES    = 4096;
+static constexpr uint32_t   READ_CLOCK_HZ       = 1000000;  // RAM reads are specced far slower than writes
+static constexpr int        TEST_BYTES          = 256;
+static constexpr int        RC_STALE_BASE       = -4;       // stream_partial(), prev isn't what 0x24 holds
+
+struct Upload
+{
+    const uint8_t*      frame;
+    const uint8_t*      prev;           // partial only, the frame on the panel
+    uint32_t            frame_crc;      // 1bpp only, Epd::PlaneCrc() of the whole frame
+    DisplayRefresh      refresh;
+    Lut                 lut;            // 4-gray only
+    DisplayRect         rects[DISPLAY_MAX_RECTS];
+    int                 n_rects;        // partial only
+    DisplayDoneFn       done;
+    void*               user;
+
+    uint8_t*            staging;        // both 4-gray RAM planes, or the partial windows back to back
+    spi_device_handle_t device;
+    spi_transaction_t   trans[MAX_TRANSACTIONS];
+    int                 trans_count;
+
+    int                 rc;
+    uint32_t            busy_ms;
+    int                 sent_bytes;     // RAM plane bytes, windows included
+    int                 skipped_bytes;  // whole planes the RAM already held
+};
+
+static Upload               upload = {};
+
+// static like draw's frame buffers, so an upload doesn't touch the heap; word aligned
+// internal RAM, which DMA reads in place. Windows never add up to more than a plane
+alignas(4) static uint8_t   staging_buf[2 * PLANE_BYTES];
+static bool                 in_flight = false;
+static SemaphoreHandle_t    done_sem = nullptr;     // given by the task when it finishes
+static gpio_num_t           dc_gpio = GPIO_NUM_NC;  // DC_PIN, resolved before the ISR needs it
+
+// the self-test only reruns when the configured clock changes or RTC memory is lost
+RTC_DATA_ATTR static uint32_t   spi_configured_hz = 0;
+RTC_DATA_ATTR static uint32_t   spi_verified_hz = 0;
+
+// the last upload was a 1bpp frame, now on the panel and in 0x24 as long as that still
+// holds panel_crc; the controller keeps its RAM through deep sleep
+RTC_DATA_ATTR static bool       panel_ram_valid = false;
+RTC_DATA_ATTR static uint32_t   panel_crc = 0;
+
+// DC follows each transaction, command bytes go out with t->user == 0
+static void IRAM_ATTR on_pre_transfer(spi_transaction_t* t)
+{
+    gpio_set_level(dc_gpio, (uint32_t) (uintptr_t) t->user);
+}
+
+static void add_transaction(const uint8_t* data, int len, bool is_data)
+{
+    assert(upload.trans_count < MAX_TRANSACTIONS);
+
+    spi_transaction_t* t = &upload.trans[upload.trans_count++];
+    memset(t, 0, sizeof(*t));
+    t->length = len * 8;
+    t->user = (void*) (uintptr_t) (is_data ? 1 : 0);
+
+    if (len <= 4) {
+        t->flags = SPI_TRANS_USE_TXDATA;
+        memcpy(t->tx_data, data, len);
+    } else {
+        t->tx_buffer = data;
+    }
+}
+
+static void add_byte(uint8_t byte, bool is_data)
+{
+    add_transaction(&byte, 1, is_data);
+}
+
+static void add_ram_cursor()
+{
+    const uint8_t y[2] = { 0x00, 0x00 };
+
+    add_byte(0x4E, false);
+    add_byte(0x00, true);
+    add_byte(0x4F, false);
+    add_transaction(y, sizeof(y), true);
+}
+
+static int transmit_all()
+{
+    for (int i = 0; i < upload.trans_count; i++) {
+        if (spi_device_polling_transmit(upload.device, &upload.trans[i]) != ESP_OK)
+            return -1;
+    }
+
+    return 0;
+}
+
+// the board numbers pins the Arduino way, ESP-IDF takes GPIO numbers
+static int to_gpio(int pin)
+{
+    return digitalPinToGPIONumber(pin);
+}
+
+static int device_add(uint32_t hz, uint32_t flags)
+{
+    spi_device_interface_config_t dev;
+    memset(&dev, 0, sizeof(dev));
+    dev.mode = 0;
+    dev.clock_speed_hz = hz;
+    dev.spics_io_num = to_gpio(CS_PIN);
+    dev.flags = flags;
+    dev.queue_size = MAX_TRANSACTIONS;
+    dev.pre_cb = on_pre_transfer;
+
+    if (spi_bus_add_device(SPI2_HOST, &dev, &upload.device) != ESP_OK) {
+        upload.device = nullptr;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void device_remove()
+{
+    if (upload.device)
+        spi_bus_remove_device(upload.device);
+    upload.device = nullptr;
+}
+
+static int bus_begin(uint32_t hz)
+{
+    // the Arduino SPI driver owns the same host, it's handed back in bus_end()
+    EpdIf::SpiRelease();
+    dc_gpio = (gpio_num_t) to_gpio(DC_PIN);
+
+    spi_bus_config_t bus;
+    memset(&bus, 0, sizeof(bus));
+    bus.mosi_io_num = to_gpio(MOSI);
+    bus.miso_io_num = -1;
+    bus.sclk_io_num = to_gpio(SCK);
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = PLANE_BYTES;
+
+    if (spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK) {
+        EpdIf::IfInit();
+        return -1;
+    }
+
+    if (device_add(hz, 0)) {
+        spi_bus_free(SPI2_HOST);
+        EpdIf::IfInit();
+        return -1;
+    }
+
+    return 0;
+}
+
+static void bus_end()
+{
+    device_remove();
+    spi_bus_free(SPI2_HOST);
+    EpdIf::IfInit();
+}
+
+static void add_window(const DisplayRect& rect, uint8_t ram, const uint8_t* data)
+{
+    const uint8_t x0 = rect.x0 / 8;
+    const uint8_t x1 = rect.x1 / 8 - 1;
+    const uint8_t y[4] = {
+        (uint8_t) (rect.y0 & 0xFF), (uint8_t) ((rect.y0 >> 8) & 0x01),
+        (uint8_t) ((rect.y1 - 1) & 0xFF), (uint8_t) (((rect.y1 - 1) >> 8) & 0x01),
+    };
+    const uint8_t x[2] = { x0, x1 };
+
+    add_byte(0x44, false);
+    add_transaction(x, sizeof(x), true);
+    add_byte(0x45, false);
+    add_transaction(y, sizeof(y), true);
+    add_byte(0x4E, false);
+    add_byte(x0, true);
+    add_byte(0x4F, false);
+    add_transaction(y, 2, true);
+    add_byte(ram, false);
+    add_transaction(data, (rect.x1 - rect.x0) / 8 * (rect.y1 - rect.y0), true);
+}
+
+static int stream_partial()
+{
+    // as Epd::Display_Partial(), with every window written before a single refresh
+    upload.trans_count = 0;
+    add_byte(0x3C, false);      // border waveform
+    add_byte(0x80, true);
+    add_byte(0x21, false);      // both RAM planes as they are
+    add_byte(0x00, true);
+    add_byte(0x00, true);
+    int rc = transmit_all();
+
+    // the partial waveform diffs 0x24 against 0x26, whole frame uploads leave 0x26 behind
+    if (rc == 0 && !Epd::PlanesMatch()) {
+        // prev is a re-render, it has to match what's shown to stand in for it
+        if (!Epd::PlaneHolds(0x24, Epd::PlaneCrc(upload.prev, PLANE_BYTES)))
+            return RC_STALE_BASE;
+
+        const DisplayRect all = { 0, 0, EPD_WIDTH, EPD_HEIGHT };
+        Epd::PlaneChanged(0x26);
+        upload.trans_count = 0;
+        add_window(all, 0x26, upload.prev);
+        rc = transmit_all();
+        upload.sent_bytes += PLANE_BYTES;
+    }
+
+    Epd::PlaneChanged(0x24);
+    Epd::PlaneChanged(0x26);
+    const uint8_t* data = upload.staging;
+    for (int i = 0; i < upload.n_rects && rc == 0; i++) {
+        const DisplayRect& rect = upload.rects[i];
+        upload.trans_count = 0;
+        add_window(rect, 0x24, data);
+        rc = transmit_all();
+        data += (rect.x1 - rect.x0) / 8 * (rect.y1 - rect.y0);
+        upload.sent_bytes += (rect.x1 - rect.x0) / 8 * (rect.y1 - rect.y0);
+    }
+
+    if (rc == 0) {
+        upload.trans_count = 0;
+        add_byte(0x22, false);
+        add_byte(0xFF, true);       // TurnOnDisplay_Partial
+        add_byte(0x20, false);
+        rc = transmit_all();
+    }
+
+    unsigned long busy_ms = 0;
+    if (rc == 0 && EpdIf::WaitLow(BUSY_PIN, BUSY_TIMEOUT_MS, &busy_ms) != 0)
+        rc = -3;
+    upload.busy_ms = busy_ms;
+
+    // bring 0x26 up to what's shown now, ready for the next one
+    data = upload.staging;
+    for (int i = 0; i < upload.n_rects && rc == 0; i++) {
+        const DisplayRect& rect = upload.rects[i];
+        upload.trans_count = 0;
+        add_window(rect, 0x26, data);
+        rc = transmit_all();
+        data += (rect.x1 - rect.x0) / 8 * (rect.y1 - rect.y0);
+        upload.sent_bytes += (rect.x1 - rect.x0) / 8 * (rect.y1 - rect.y0);
+    }
+
+    if (rc == 0) {
+        Epd::PlaneWritten(0x24, upload.frame_crc);
+        Epd::PlaneWritten(0x26, upload.frame_crc);
+    }
+
+    return rc;
+}
+
+static int stream()
+{
+    const bool gray4 = (upload.refresh == DISPLAY_REFRESH_GRAY4);
+    const uint8_t* plane_24 = upload.frame;
+    const uint8_t* plane_26 = upload.frame;
+    if (gray4) {
+        plane_24 = upload.staging;
+        plane_26 = upload.staging + PLANE_BYTES;
+    }
+
+    // the full and fast inits bypass 0x26 (0x21 0x40), only partial refreshes read it and
+    // stream_partial() brings it up to date first. A plane already in RAM isn't sent again.
+    const uint32_t crc_24 = Epd::PlaneCrc(plane_24, PLANE_BYTES);
+    const bool send_24 = !Epd::PlaneHolds(0x24, crc_24);
+    // the 4-gray refresh runs in display mode 2, which may rewrite 0x26 itself, so 0x26 is
+    // left untracked and sent with every 4-gray frame
+    const bool send_26 = gray4;
+    if (!gray4)
+        upload.frame_crc = crc_24;
+
+    // a retained init leaves the address counter wherever the last access did
+    upload.trans_count = 0;
+    if (send_24) {
+        Epd::PlaneChanged(0x24);
+        add_ram_cursor();
+        add_byte(0x24, false);
+        add_transaction(plane_24, PLANE_BYTES, true);
+    }
+    if (send_26) {
+        Epd::PlaneChanged(0x26);
+        add_ram_cursor();
+        add_byte(0x26, false);
+        add_transaction(plane_26, PLANE_BYTES, true);
+    }
+    upload.sent_bytes = (send_24 + send_26) * PLANE_BYTES;
+    upload.skipped_bytes = 2 * PLANE_BYTES - upload.sent_bytes;
+    add_byte(0x22, false);
+    switch (upload.refresh) {
+        case DISPLAY_REFRESH_FULL:  add_byte(0xF7, true); break;   // TurnOnDisplay
+        case DISPLAY_REFRESH_GRAY4: add_byte(0xCF, true); break;   // TurnOnDisplay_4Gray
+        default:                    add_byte(0xC7, true); break;   // TurnOnDisplay_Fast
+    }
+    add_byte(0x20, false);
+
+    int rc = 0;
+    int queued = 0;
+    for (; queued < upload.trans_count; queued++) {
+        if (spi_device_queue_trans(upload.device, &upload.trans[queued], portMAX_DELAY) != ESP_OK) {
+            rc = -2;
+            break;
+        }
+    }
+
+    for (int i = 0; i < queued; i++) {
+        spi_transaction_t* t;
+        spi_device_get_trans_result(upload.device, &t, portMAX_DELAY);
+    }
+
+    if (rc == 0 && send_24)
+        Epd::PlaneWritten(0x24, crc_24);
+
+    // as Epd::ReadBusy(), light sleeping through the refresh when enabled
+    unsigned long busy_ms = 0;
+    if (rc == 0 && EpdIf::WaitLow(BUSY_PIN, BUSY_TIMEOUT_MS, &busy_ms) != 0)
+        rc = -3;
+    upload.busy_ms = busy_ms;
+
+    // no deep sleep, the refresh already turned the analog and oscillator off and standby keeps
+    // the registers and LUT so the next wake can skip the init, see Epd::Retained()
+    return rc;
+}
+
+// writes a pattern into the black / white RAM at hz, then reads it back through 0x27 over the
+// panel's bidirectional DIN line (3-wire) at the slow read clock
+static int spi_self_test(uint32_t hz)
+{
+    alignas(4) static uint8_t pattern[TEST_BYTES];
+    alignas(4) static uint8_t readback[TEST_BYTES + 4];     // led by a dummy byte
+
+    for (int i = 0; i < TEST_BYTES; i++)
+        pattern[i] = (uint8_t) (i * 113 + 0x35);
+    memset(readback, 0, sizeof(readback));
+
+    if (bus_begin(hz))
+        return -1;
+
+    Epd::PlaneChanged(0x24);
+    upload.trans_count = 0;
+    add_ram_cursor();
+    add_byte(0x24, false);
+    add_transaction(pattern, TEST_BYTES, true);
+    int rc = transmit_all();
+    device_remove();
+
+    if (rc == 0)
+        rc = device_add(READ_CLOCK_HZ, SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX);
+
+    if (rc == 0) {
+        upload.trans_count = 0;
+        add_byte(0x41, false);      // read from the black / white RAM
+        add_byte(0x00, true);
+        add_ram_cursor();
+        rc = transmit_all();
+    }
+
+    if (rc == 0) {
+        // the read has to follow 0x27 within the same chip select
+        spi_device_acquire_bus(upload.device, portMAX_DELAY);
+
+        upload.trans_count = 0;
+        add_byte(0x27, false);
+        upload.trans[0].flags |= SPI_TRANS_CS_KEEP_ACTIVE;
+        rc = transmit_all();
+
+        spi_transaction_t t;
+        memset(&t, 0, sizeof(t));
+        t.rxlength = (TEST_BYTES + 1) * 8;
+        t.rx_buffer = readback;
+        t.user = (void*) 1;
+        if (rc == 0 && spi_device_polling_transmit(upload.device, &t) != ESP_OK)
+            rc = -1;
+
+        spi_device_release_bus(upload.device);
+    }
+
+    bus_end();
+
+    if (rc == 0 && memcmp(pattern, readback + 1, TEST_BYTES) != 0)
+        rc = -2;
+    return rc;
+}
+
+static int bus_stream()
+{
+    int rc = bus_begin(EpdIf::GetSpiClock());
+    if (rc == 0) {
+        rc = (upload.refresh == DISPLAY_REFRESH_PARTIAL) ? stream_partial() : stream();
+        bus_end();
+    }
+
+    return rc;
+}
+
+static void upload_task(void*)
+{
+    Epd epd;
+    int rc;
+    switch (upload.refresh) {
+        case DISPLAY_REFRESH_PARTIAL:
+            // Display_Partial() doesn't init either, the windows and partial waveform it loads
+            // leave nothing worth retaining
+            rc = epd.Wake();
+            break;
+        case DISPLAY_REFRESH_FULL:  rc = epd.Init(); break;
+        case DISPLAY_REFRESH_GRAY4: rc = epd.Init_4Gray(upload.lut.data, upload.lut.id); break;
+        default:                    rc = epd.Init_Fast(Seconds_1S); break;
+    }
+
+    if (rc == 0 && upload.refresh == DISPLAY_REFRESH_GRAY4)
+        Epd::Gray4ToPlanes(upload.frame, PLANE_BYTES, upload.staging, upload.staging + PLANE_BYTES);
+
+    if (rc == 0)
+        rc = bus_stream();
+
+    // nothing was refreshed, the frame still goes out whole rather than being dropped
+    if (rc == RC_STALE_BASE) {
+        Serial.print("DISPLAY > Panel RAM doesn't hold the previous frame, sending a fast refresh.\n");
+        upload.refresh = DISPLAY_REFRESH_FAST;
+        rc = epd.Init_Fast(Seconds_1S);
+        if (rc == 0)
+            rc = bus_stream();
+    }
+
+    upload.rc = rc;
+    panel_ram_valid = (rc == 0 && upload.refresh != DISPLAY_REFRESH_GRAY4);
+    panel_crc = upload.frame_crc;
+
+    if (rc == 0)
+        Serial.printf("DISPLAY > Sent %d RAM bytes, skipped %d.\n",
+            upload.sent_bytes, upload.skipped_bytes);
+
+    if (upload.done)
+        upload.done(rc, upload.busy_ms, upload.user);
+
+    xSemaphoreGive(done_sem);
+    vTaskDelete(nullptr);
+}
+
+static int upload_prepare(const uint8_t* frame, DisplayRefresh refresh, int staging_bytes,
+    DisplayDoneFn done, void* user)
+{
+    display_wait();
+
+    if (!done_sem) {
+        done_sem = xSemaphoreCreateBinary();
+        if (!done_sem)
+            return -1;
+    }
+
+    upload.frame = frame;
+    upload.prev = nullptr;
+    upload.frame_crc = 0;
+    upload.refresh = refresh;
+    upload.n_rects = 0;
+    upload.done = done;
+    upload.user = user;
+    upload.rc = 0;
+    upload.busy_ms = 0;
+    upload.sent_bytes = 0;
+    upload.skipped_bytes = 0;
+    assert(staging_bytes <= (int) sizeof(staging_buf));
+    upload.staging = staging_bytes ? staging_buf : nullptr;
+
+    // whatever happens next, the RAM planes stop matching until the upload succeeds
+    panel_ram_valid = false;
+    return 0;
+}
+
+static int upload_start()
+{
+    in_flight = true;
+    if (xTaskCreate(upload_task, "display", TASK_STACK_BYTES, nullptr, 2, nullptr) != pdPASS) {
+        in_flight = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+int display_begin_upload(const uint8_t* frame, DisplayRefresh refresh, Waveform waveform,
+    DisplayDoneFn done, void* user)
+{
+    assert(refresh != DISPLAY_REFRESH_PARTIAL);
+
+    const bool gray4 = (refresh == DISPLAY_REFRESH_GRAY4);
+    if (upload_prepare(frame, refresh, gray4 ? 2 * PLANE_BYTES : 0, done, user))
+        return -1;
+
+    if (gray4) {
+        // a bad or missing table falls back to the standard one rather than failing the frame
+        lut_get(waveform, &upload.lut);
+        Serial.printf("DISPLAY > Waveform: %s, %d frames.\n",
+            lut_name(upload.lut.waveform), lut_frames(upload.lut.data));
+    }
+
+    return upload_start();
+}
+
+int display_begin_partial(const uint8_t* frame, const uint8_t* prev, const DisplayRect* rects,
+    int n_rects, DisplayDoneFn done, void* user)
+{
+    assert(n_rects > 0 && n_rects <= DISPLAY_MAX_RECTS);
+
+    int bytes = 0;
+    for (int i = 0; i < n_rects; i++) {
+        const DisplayRect& rect = rects[i];
+        assert(rect.x0 % 8 == 0 && rect.x1 % 8 == 0);
+        assert(rect.x0 < rect.x1 && rect.y0 < rect.y1);
+        bytes += (rect.x1 - rect.x0) / 8 * (rect.y1 - rect.y0);
+    }
+
+    if (upload_prepare(frame, DISPLAY_REFRESH_PARTIAL, bytes, done, user))
+        return -1;
+
+    // gathered now, the frame itself is only read again for a whole frame fallback
+    uint8_t* data = upload.staging;
+    for (int i = 0; i < n_rects; i++) {
+        const DisplayRect& rect = rects[i];
+        const int w = (rect.x1 - rect.x0) / 8;
+        for (int y = rect.y0; y < rect.y1; y++) {
+            memcpy(data, frame + y * STRIDE + rect.x0 / 8, w);
+            data += w;
+        }
+        upload.rects[i] = rect;
+    }
+    upload.n_rects = n_rects;
+    upload.prev = prev;
+    upload.frame_crc = Epd::PlaneCrc(frame, PLANE_BYTES);
+
+    return upload_start();
+}
+
+bool display_partial_ready()
+{
+    return panel_ram_valid && Epd::PlaneHolds(0x24, panel_crc);
+}
+
+int display_diff(const uint8_t* prev, const uint8_t* cur, DisplayRect* rects, int max_rects)
+{
+    assert(max_rects > 0);
+
+    int n = 0;
+    int y = 0;
+    while (y < EPD_HEIGHT) {
+        if (memcmp(prev + y * STRIDE, cur + y * STRIDE, STRIDE) == 0) {
+            y++;
+            continue;
+        }
+
+        // a band of consecutive rows that differ, and which byte columns differ anywhere in it
+        uint8_t cols[STRIDE] = { 0 };
+        const int band_y0 = y;
+        for (; y < EPD_HEIGHT && memcmp(prev + y * STRIDE, cur + y * STRIDE, STRIDE) != 0; y++) {
+            for (int i = 0; i < STRIDE; i++)
+                cols[i] |= prev[y * STRIDE + i] ^ cur[y * STRIDE + i];
+        }
+        const int band_y1 = y;
+        const int band_h = band_y1 - band_y0;
+
+        // split at clean column gaps that cost more to send than another window
+        int i = 0;
+        while (i < STRIDE) {
+            if (!cols[i]) {
+                i++;
+                continue;
+            }
+
+            const int x0 = i;
+            int x1 = i + 1;
+            for (int j = x1; j < STRIDE; j++) {
+                if (!cols[j])
+                    continue;
+                if ((j - x1) * band_h > RECT_OVERHEAD_BYTES)
+                    break;
+                x1 = j + 1;
+            }
+            i = x1;
+
+            // only the rows that differ within those columns
+            int y0 = band_y1;
+            int y1 = band_y0;
+            for (int r = band_y0; r < band_y1; r++) {
+                if (memcmp(prev + r * STRIDE + x0, cur + r * STRIDE + x0, x1 - x0) != 0) {
+                    if (r < y0)
+                        y0 = r;
+                    y1 = r + 1;
+                }
+            }
+
+            const DisplayRect rect = { x0 * 8, y0, x1 * 8, y1 };
+            if (n < max_rects) {
+                rects[n++] = rect;
+            } else {
+                // out of rects, the last one grows to cover the rest
+                DisplayRect& last = rects[n - 1];
+                last.x0 = (rect.x0 < last.x0) ? rect.x0 : last.x0;
+                last.y0 = (rect.y0 < last.y0) ? rect.y0 : last.y0;
+                last.x1 = (rect.x1 > last.x1) ? rect.x1 : last.x1;
+                last.y1 = (rect.y1 > last.y1) ? rect.y1 : last.y1;
+            }
+        }
+    }
+
+    return n;
+}
+
+int display_wait()
+{
+    if (in_flight) {
+        xSemaphoreTake(done_sem, portMAX_DELAY);
+        in_flight = false;
+    }
+
+    return upload.rc;
+}
+
+uint32_t display_spi_init(uint32_t hz)
+{
+    if (hz == spi_configured_hz && spi_verified_hz) {
+        EpdIf::SetSpiClock(spi_verified_hz);
+        return spi_verified_hz;
+    }
+
+    display_wait();
+
+    // the test pattern lands in the black / white RAM
+    panel_ram_valid = false;
+
+    // the default is known good, only faster clocks are tested, halving down to it
+    uint32_t verified = SPI_CLOCK_HZ;
+    Epd epd;
+    if (epd.Init() == 0) {
+        for (uint32_t test_hz = hz; ; test_hz /= 2) {
+            if (test_hz <= SPI_CLOCK_HZ) {
+                verified = (test_hz == hz) ? hz : SPI_CLOCK_HZ;
+                break;
+            }
+
+            const int rc = spi_self_test(test_hz);
+            if (rc == 0) {
+                verified = test_hz;
+                break;
+            }
+
+            Serial.printf("DISPLAY > SPI self-test failed at %u kHz (%d).\n", (unsigned) (test_hz / 1000), rc);
+        }
+        epd.Sleep();
+    }
+
+    Serial.printf("DISPLAY > SPI clock: %u kHz.\n", (unsigned) (verified / 1000));
+
+    spi_configured_hz = hz;
+    spi_verified_hz = verified;
+    EpdIf::SetSpiClock(verified);
+    return verified;
+}
+
+void display_set_light_sleep(bool enable)
+{
+    EpdIf::SetBusySleep(enable);
+}
+
+void display_hold_pins()
+{
+    EpdIf::HoldPins();
+}
+
+bool display_busy()
+{
+    return in_flight && uxSemaphoreGetCount(done_sem) == 0;
+}
+
+} // namespace paper
\ No newline at end of file
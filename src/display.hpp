@@ -0,0 +1,75 @@
+// display.hpp
+
+#ifndef __PAPER_DISPLAY_HPP__
+#define __PAPER_DISPLAY_HPP__
+
+#include "lut.hpp"
+
+#include <stdint.h>
+
+
+
+namespace paper {
+
+// a byte aligned window of the 1bpp frame, px, x1 / y1 exclusive
+struct DisplayRect
+{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+static constexpr int DISPLAY_MAX_RECTS = 4;
+
+enum DisplayRefresh
+{
+    DISPLAY_REFRESH_PARTIAL,    // dirty windows only, partial waveform, ghosts build up
+    DISPLAY_REFRESH_FAST,       // whole frame, fast waveform
+    DISPLAY_REFRESH_FULL,       // whole frame, full quality waveform, clears ghosting
+    DISPLAY_REFRESH_GRAY4,      // whole 2bpp frame, 4-gray waveform
+};
+
+// called from the upload task once the panel has refreshed, rc is 0 on success
+typedef void (*DisplayDoneFn)(int rc, uint32_t busy_ms, void* user);
+
+// starts a whole frame upload (any refresh but partial) and returns right away,
+// the frame is streamed by DMA straight from memory so it must stay untouched until done,
+// waveform only applies to DISPLAY_REFRESH_GRAY4
+int display_begin_upload(const uint8_t* frame, DisplayRefresh refresh, Waveform waveform,
+    DisplayDoneFn done, void* user);
+
+// uploads only rects of a 1bpp frame and refreshes them with the partial waveform.
+// prev is the frame on the panel, streamed into the old data RAM if that's behind. If the
+// panel's RAM doesn't hold prev, the whole frame goes out with a fast refresh instead, so
+// both must stay untouched until done
+int display_begin_partial(const uint8_t* frame, const uint8_t* prev, const DisplayRect* rects,
+    int n_rects, DisplayDoneFn done, void* user);
+
+// true while the RAM holds the last 1bpp frame uploaded, which partial refreshes rely on
+bool display_partial_ready();
+
+// byte aligned rects covering every difference between two 1bpp frames, at most max_rects,
+// returns how many, 0 if the frames match
+int display_diff(const uint8_t* prev, const uint8_t* cur, DisplayRect* rects, int max_rects);
+
+// blocks until the upload in flight, if any, has finished and returns its rc
+int display_wait();
+
+bool display_busy();
+
+// sets the EPD write clock, self-testing hz by RAM readback and falling back to slower clocks,
+// returns the clock in use
+uint32_t display_spi_init(uint32_t hz);
+
+// light sleep through panel BUSY waits, the USB serial drops while asleep
+void display_set_light_sleep(bool enable);
+
+// call right before deep sleep, keeps the panel's control lines steady through it
+void display_hold_pins();
+
+} // namespace paper
+
+
+
+#endif // __PAPER_DISPLAY_HPP__
\ No newline at end of file
@@ -3,48 +3,108 @@
 #include "draw.hpp"
 
 #include "composite.h"
+#include "display.hpp"
 #include "fonts.h"
 #include "images.h"
+#include "refresh.hpp"
 #include "ttf_render.h"
-#include "epd/epd4in2_V2.h"
+
+#include <Arduino.h>
 
 
 
 static constexpr uint8_t    DARK_GRAY = 0x80;
 static constexpr int        DISPLAY_W = 400;
 static constexpr int        DISPLAY_H = 300;
+static constexpr int        ARENA_BYTES = 64 * 1024;   // stb_truetype's edge heap alone takes ~56 KB
 
-namespace paper {
+// static so a frame doesn't touch the heap, word aligned so DMA reads it in place
+alignas(4) static uint8_t   display_buf[DISPLAY_W * DISPLAY_H / 4];
+alignas(4) static uint8_t   shown_buf[DISPLAY_W * DISPLAY_H / 8];
+static uint8_t              arena_buf[ARENA_BYTES];
 
-int draw(const DrawInfo& info)
+RTC_DATA_ATTR static struct TTF_cache glyph_cache = {};
+RTC_DATA_ATTR static struct TTF_font regular_font = {};
+RTC_DATA_ATTR static struct TTF_font bold_font = {};
+
+// the date only changes once a day, keep it shaped
+struct DateRun
 {
-    Serial.printf("DRAW    > %s / %s\n", info.time_str, info.date_str);
-    Serial.print("DRAW    > Rendering... ");
+    char            str[32];
+    struct TTF_run  run;
+};
 
-    const int scratch_bytes = 64 * 1024;
-    const int display_bytes = DISPLAY_W * DISPLAY_H / (info.enable_2bpp ? 4 : 8);
-    uint32_t start = millis();
+RTC_DATA_ATTR static DateRun date_run = {};
+
+// the 1bpp frame on the panel, as a recipe, re-rendered into shown_buf to diff against
+struct ShownFrame
+{
+    bool    valid;
+    char    time_str[32];
+    char    date_str[32];
+    bool    network_error;
+    int     dither;
+};
+
+RTC_DATA_ATTR static ShownFrame shown = {};
 
-    uint8_t* buf_8bpp = (uint8_t*) calloc(scratch_bytes, 1);
-    uint8_t* display_Xbpp = (uint8_t*) calloc(display_bytes, 1);
+static ShownFrame           sending = {};       // becomes shown once its upload succeeds
+static uint32_t             upload_start = 0;
+
+// runs in the upload task, draw() waits for it before reading shown
+static void on_display_done(int rc, uint32_t busy_ms, void*)
+{
+    if (rc) {
+        // the panel may hold either frame or neither
+        shown.valid = false;
+        Serial.printf("Error: Display upload failed (%d).\n", rc);
+    } else {
+        shown = sending;
+        Serial.printf("DRAW    > Display done (%d ms, %d ms busy).\n",
+            (int) (millis() - upload_start), (int) busy_ms);
+    }
+}
+
+static void grow_rect(struct TTF_rect* rect, const struct TTF_rect& other)
+{
+    if (other.x0 >= other.x1 || other.y0 >= other.y1)
+        return;
+
+    rect->x0 = min(rect->x0, other.x0);
+    rect->y0 = min(rect->y0, other.y0);
+    rect->x1 = max(rect->x1, other.x1);
+    rect->y1 = max(rect->y1, other.y1);
+}
+
+// composites straight into the panel's encoding, 1 = white
+static void render(const paper::DrawInfo& info, const struct composite_fb& fb, struct TTF_arena* arena,
+    struct TTF_rect* ink)
+{
+    TTF_arena_init(arena, arena_buf, ARENA_BYTES);
+    composite_fill_blank(&fb);
+
+    // union of everything drawn this frame
+    *ink = { DISPLAY_W, DISPLAY_H, 0, 0 };
 
     {
         // time string
 
         const int x = DISPLAY_W / 2;
         const int y = 50;
-        const int w = 320;
-        const int h = 160;
 
         struct TTF_t ttf;
-        TTF_init(&ttf, notoserif_regular_ttf);
-        TTF_set_canvas(&ttf, buf_8bpp, w, h);
-        TTF_render_centered(&ttf, info.time_str, w / 2, 0, 144);
-
-        if (info.enable_2bpp)
-            composite_8bpp_to_2bpp(display_Xbpp, x - w / 2, y, w, h, DISPLAY_W, buf_8bpp);
-        else
-            composite_8bpp_to_1bpp(display_Xbpp, x - w / 2, y, w, h, DISPLAY_W, buf_8bpp);
+        TTF_set_canvas_packed(&ttf, &fb, 0xFF);
+
+        // digits are pre-rasterized, anything else goes through stb_truetype
+        if (TTF_atlas_render_centered(&ttf, &notoserif_regular_144_atlas, info.time_str, x, y) < 0) {
+            TTF_init_font(&ttf, notoserif_regular_ttf, &regular_font);
+            TTF_set_kerning(&ttf, notoserif_regular_kern);
+            TTF_set_cache(&ttf, &glyph_cache);
+            TTF_set_arena(&ttf, arena);
+            TTF_render_centered(&ttf, info.time_str, x, y, 144);
+        }
+
+        grow_rect(ink, ttf.dirty);
     }
 
     {
@@ -52,20 +112,21 @@ int draw(const DrawInfo& info)
 
         const int x = DISPLAY_W / 2;
         const int y = 200;
-        const int w = 320;
-        const int h = 100;
-        
-        memset(buf_8bpp, 0, scratch_bytes);
 
         struct TTF_t ttf;
-        TTF_init(&ttf, notoserif_bold_ttf);
-        TTF_set_canvas(&ttf, buf_8bpp, w, h);
-        TTF_render_centered(&ttf, info.date_str, w / 2, 0, 60);
-
-        if (info.enable_2bpp)
-            composite_8bpp_to_2bpp_level(display_Xbpp, x - w / 2, y, w, h, DISPLAY_W, buf_8bpp, DARK_GRAY);
-        else
-            composite_8bpp_to_1bpp(display_Xbpp, x - w / 2, y, w, h, DISPLAY_W, buf_8bpp);
+        TTF_init_font(&ttf, notoserif_bold_ttf, &bold_font);
+        TTF_set_kerning(&ttf, notoserif_bold_kern);
+        TTF_set_canvas_packed(&ttf, &fb, info.enable_2bpp ? DARK_GRAY : 0xFF);
+        TTF_set_cache(&ttf, &glyph_cache);
+        TTF_set_arena(&ttf, arena);
+
+        if (strncmp(date_run.str, info.date_str, sizeof(date_run.str)) != 0) {
+            TTF_shape(&ttf, &date_run.run, info.date_str, 60);
+            strncpy(date_run.str, info.date_str, sizeof(date_run.str) - 1);
+        }
+
+        TTF_render_run(&ttf, &date_run.run, x, y, TTF_ALIGN_CENTER);
+        grow_rect(ink, ttf.dirty);
     }
 
     if (info.network_error) {
@@ -77,38 +138,108 @@ int draw(const DrawInfo& info)
         const int h = img_network_error.h;
 
         if (info.enable_2bpp)
-            composite_8bpp_to_2bpp_level(display_Xbpp, x, y, w, h, DISPLAY_W, img_network_error.data_8bpp, DARK_GRAY);
+            composite_8bpp_to_2bpp_level(&fb, x, y, w, h, img_network_error.data_8bpp, DARK_GRAY,
+                COMPOSITE_OP_OR);
         else
-            composite_8bpp_to_1bpp(display_Xbpp, x, y, w, h, DISPLAY_W, img_network_error.data_8bpp);
-    }
+            composite_8bpp_to_1bpp(&fb, x, y, w, h, img_network_error.data_8bpp, COMPOSITE_OP_OR);
 
-    // invert colors
-    for (int i = 0; i < display_bytes; i += 4) {
-        uint32_t* x = (uint32_t*) &display_Xbpp[i];
-        *x = ~(*x);
+        grow_rect(ink, { x, y, x + w, y + h });
     }
-    
-    Serial.printf("done (%d ms).\n", (int) (millis() - start));
+}
 
-    Serial.print("DRAW    > Sending to display... ");
-    start = millis();
+namespace paper {
 
-    Epd epd;
-    if (info.enable_2bpp) {
-        epd.Init_4Gray();
-        epd.Set_4GrayDisplay(display_Xbpp, 0, 0, DISPLAY_W, DISPLAY_H);
-    } else {
-        epd.Init_Fast(Seconds_1S);
-        epd.Display_Fast(display_Xbpp);
+int draw(const DrawInfo& info)
+{
+    Serial.printf("DRAW    > %s / %s\n", info.time_str, info.date_str);
+
+    // the previous frame may still be streaming out of display_buf
+    display_wait();
+
+    const bool partial_ok = !info.enable_2bpp && shown.valid && shown.dither == info.dither &&
+        display_partial_ready();
+    const DisplayRefresh refresh = refresh_choose(info.enable_2bpp, partial_ok, info.partial_limit,
+        info.full_refresh_min);
+
+    Serial.print("DRAW    > Rendering... ");
+
+    const int bpp = info.enable_2bpp ? 2 : 1;
+    const int display_bytes = DISPLAY_W * DISPLAY_H / (info.enable_2bpp ? 4 : 8);
+    uint32_t start = millis();
+
+    const uint32_t cache_hits = glyph_cache.hits;
+    const uint32_t cache_misses = glyph_cache.misses;
+    TTF_cache_begin(&glyph_cache);
+
+    struct TTF_arena arena;
+    struct TTF_rect ink;
+
+    // the previous frame first, so the date run is left shaped for the current one
+    if (refresh == DISPLAY_REFRESH_PARTIAL) {
+        DrawInfo shown_info = info;
+        shown_info.time_str = shown.time_str;
+        shown_info.date_str = shown.date_str;
+        shown_info.network_error = shown.network_error;
+
+        const struct composite_fb shown_fb = { shown_buf, DISPLAY_W, DISPLAY_H, 1, COMPOSITE_INK_ZEROS,
+            info.dither };
+        render(shown_info, shown_fb, &arena, &ink);
     }
 
+    const struct composite_fb fb = { display_buf, DISPLAY_W, DISPLAY_H, bpp, COMPOSITE_INK_ZEROS,
+        info.enable_2bpp ? COMPOSITE_DITHER_NONE : info.dither };
+    render(info, fb, &arena, &ink);
+
     Serial.printf("done (%d ms).\n", (int) (millis() - start));
+    Serial.printf("DRAW    > Glyph cache: %u hits, %u misses (%d / %d bytes).\n",
+        (unsigned) (glyph_cache.hits - cache_hits), (unsigned) (glyph_cache.misses - cache_misses),
+        glyph_cache.pool_used, TTF_CACHE_POOL_BYTES);
+    Serial.printf("DRAW    > Glyph arena: %d / %d bytes peak, %d heap fallbacks.\n",
+        arena.high_water, ARENA_BYTES, arena.overflows);
+
+    if (ink.x0 < ink.x1) {
+        // byte aligned, as a partial window on the panel has to be
+        const int pixels_per_byte = 8 / bpp;
+        const int ink_bytes = (ink.y1 - ink.y0) *
+            ((ink.x1 + pixels_per_byte - 1) / pixels_per_byte - ink.x0 / pixels_per_byte);
+        Serial.printf("DRAW    > Ink: (%d, %d) - (%d, %d), %d / %d bytes.\n",
+            ink.x0, ink.y0, ink.x1, ink.y1, ink_bytes, display_bytes);
+    }
+
+    // -1 for a full upload
+    DisplayRect rects[DISPLAY_MAX_RECTS];
+    const int n_rects = (refresh == DISPLAY_REFRESH_PARTIAL) ?
+        display_diff(shown_buf, display_buf, rects, DISPLAY_MAX_RECTS) : -1;
 
-    //delay(5000);
+    if (n_rects >= 0) {
+        int diff_bytes = 0;
+        for (int i = 0; i < n_rects; i++)
+            diff_bytes += (rects[i].x1 - rects[i].x0) / 8 * (rects[i].y1 - rects[i].y0);
+        Serial.printf("DRAW    > Diff: %d rects, %d / %d bytes.\n", n_rects, diff_bytes, display_bytes);
+    }
+
+    if (n_rects == 0) {
+        Serial.print("DRAW    > Unchanged, nothing to send.\n");
+        return 0;
+    }
 
-    epd.Sleep();
-    free(buf_8bpp);
-    free(display_Xbpp);
+    sending.valid = !info.enable_2bpp;
+    strncpy(sending.time_str, info.time_str, sizeof(sending.time_str) - 1);
+    strncpy(sending.date_str, info.date_str, sizeof(sending.date_str) - 1);
+    sending.network_error = info.network_error;
+    sending.dither = info.dither;
+
+    // streams and refreshes in the background, see display_wait()
+    upload_start = millis();
+    const int rc = (n_rects > 0) ?
+        display_begin_partial(display_buf, shown_buf, rects, n_rects, on_display_done, nullptr) :
+        display_begin_upload(display_buf, refresh, (Waveform) info.waveform, on_display_done, nullptr);
+    if (rc)
+        return rc;
+
+    refresh_record(refresh);
+    Serial.printf("DRAW    > Sending to display, %s (%d ms to start).\n",
+        refresh_name(refresh), (int) (millis() - upload_start));
 
     return 0;
 }
@@ -10,6 +10,10 @@ namespace paper {
 struct DrawInfo
 {
     bool        enable_2bpp;
+    int         dither;         // COMPOSITE_DITHER_*, 1bpp only
+    int         waveform;       // WAVEFORM_*, 2bpp only
+    int         partial_limit;  // partial refreshes between whole frame ones
+    int         full_refresh_min;
     bool        network_error;
     const char* time_str;
     const char* date_str;
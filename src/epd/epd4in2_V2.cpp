@@ -25,8 +25,35 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "epd4in2_V2.h"
 
+#include <esp_rom_crc.h>
+#include <esp_sleep.h>
+
+struct EpdRetained {
+    unsigned char awake;    /* out of deep sleep, registers hold what was sent */
+    unsigned char mode;     /* EPD_MODE_* */
+    unsigned int  param;    /* Init_Fast's temperature mode, Init_4Gray's lut_id */
+    unsigned char planes;   /* bit 0 0x24, bit 1 0x26: plane_crc is known */
+    uint32_t      plane_crc[2];
+};
+
+RTC_DATA_ATTR static EpdRetained retained = {};
+
+/* RTC memory outlives a chip reset, which unlike a deep sleep wake lets go
+   of the held pins, so the controller may have been reset meanwhile */
+static void CheckRetained(void) {
+    static bool checked = false;
+    if (!checked) {
+        if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED) {
+            retained.awake = 0;
+            retained.mode = EPD_MODE_NONE;
+        }
+        checked = true;
+    }
+}
+
 Epd::~Epd() {
 };
 
@@ -37,6 +64,8 @@ Epd::Epd() {
     busy_pin = BUSY_PIN;
     width = EPD_WIDTH;
     height = EPD_HEIGHT;
+    busy_ms = 0;
+    busy_ms_total = 0;
 };
 
 int Epd::Init(void) {
@@ -44,9 +73,13 @@ int Epd::Init(void) {
     if (IfInit() != 0) {
         return -1;
     }
+    if (Retained(EPD_MODE_FULL, 0)) {
+        return 0;
+    }
     /* EPD hardware init start */
-    Reset();
-    ReadBusy();
+    if (Reset() != 0) {
+        return -1;
+    }
 
     SendCommand(0x12);
     ReadBusy();
@@ -80,6 +113,7 @@ int Epd::Init(void) {
     ReadBusy();
     
     /* EPD hardware init end */
+    Retain(EPD_MODE_FULL, 0);
     return 0;
 }
 
@@ -88,9 +122,14 @@ int Epd::Init_Fast(char mode) {
     if (IfInit() != 0) {
         return -1;
     }
+    /* the temperature register picks the waveform, unchanged means the loaded one still is */
+    if (Retained(EPD_MODE_FAST, mode)) {
+        return 0;
+    }
     /* EPD hardware init start */
-    Reset();
-    ReadBusy();
+    if (Reset() != 0) {
+        return -1;
+    }
 
     SendCommand(0x12);
     ReadBusy();
@@ -139,38 +178,50 @@ int Epd::Init_Fast(char mode) {
     SendData(0x00); 
     ReadBusy();
     /* EPD hardware init end */
+    Retain(EPD_MODE_FAST, mode);
     return 0;
 }
 
-void Epd::Lut(void){
+/**
+ *  @brief: loads a waveform table laid out as LUT_ALL, EPD_LUT_BYTES long
+ */
+void Epd::Lut(const unsigned char* lut){
         SendCommand(0x32);
-        for(int i=0; i<227; i++)
-            SendData(LUT_ALL[i]);
+        SendDataBuffer(lut, 227);
 
         SendCommand(0x3F);
-        SendData(LUT_ALL[227]);
+        SendData(lut[227]);
 
         SendCommand(0x03);
-        SendData(LUT_ALL[228]);
+        SendData(lut[228]);
 
         SendCommand(0x04);
-        SendData(LUT_ALL[229]);
-        SendData(LUT_ALL[230]);
-        SendData(LUT_ALL[231]);
+        SendData(lut[229]);
+        SendData(lut[230]);
+        SendData(lut[231]);
 
         SendCommand(0x2c);
-        SendData(LUT_ALL[232]);
+        SendData(lut[232]);
 }
 
         
-int Epd::Init_4Gray(void) {
+/**
+ *  @brief: lut_id tells tables apart for Retained(), a table's contents
+ *          have to change along with its id
+ */
+int Epd::Init_4Gray(const unsigned char* lut, unsigned int lut_id) {
 	/* this calls the peripheral hardware interface, see epdif */
 	if (IfInit() != 0) {
         return -1;
     }
+    /* the same table is still loaded */
+    if (Retained(EPD_MODE_4GRAY, lut_id)) {
+        return 0;
+    }
     /* EPD hardware init start */
-    Reset();
-    ReadBusy();
+    if (Reset() != 0) {
+        return -1;
+    }
 
     SendCommand(0x12);
     ReadBusy();
@@ -188,7 +239,7 @@ int Epd::Init_4Gray(void) {
     SendData(0xA4);
     SendData(0x0F);
 
-    Lut();
+    Lut(lut);
 
     SendCommand(0x11);
     SendData(0x03);
@@ -211,6 +262,7 @@ int Epd::Init_4Gray(void) {
     SendData(0x00);
     ReadBusy();
 
+    Retain(EPD_MODE_4GRAY, lut_id);
     return 0;
 }
 
@@ -234,26 +286,126 @@ void Epd::SendData(unsigned char data) {
 }
 
 /**
- *  @brief: Wait until the busy_pin goes HIGH
+ *  @brief: send a run of data bytes with DC and CS set once
  */
-void Epd::ReadBusy(void) {
-    while(DigitalRead(busy_pin) == 1) {      //1: busy, 0: idle
-        // Wait
-    }      
+void Epd::SendDataBuffer(const unsigned char* data, unsigned int len) {
+    DigitalWrite(dc_pin, HIGH);
+    SpiWriteBuffer(data, len);
+}
+
+/**
+ *  @brief: Wait until the busy_pin goes LOW (1: busy, 0: idle),
+ *          light sleeping through long waits, see EpdIf::WaitLow()
+ */
+int Epd::ReadBusy(void) {
+    const int rc = WaitLow(busy_pin, BUSY_TIMEOUT_MS, &busy_ms);
+    busy_ms_total += busy_ms;
+
+    if (rc != 0)
+        Serial.print("Error: e-Paper busy timeout.\n");
+    return rc;
 }
 
 /**
  *  @brief: module reset. 
  *          often used to awaken the module in deep sleep, 
  *          see Epd::Sleep();
+ *          BUSY is held until the controller is ready, polling it beats
+ *          the fixed 100 ms waits either side of the pulse
  */
-void Epd::Reset(void) {
-    DigitalWrite(reset_pin, HIGH);
-    DelayMs(100);
+int Epd::Reset(void) {
     DigitalWrite(reset_pin, LOW);
     DelayMs(2);
     DigitalWrite(reset_pin, HIGH);
-    DelayMs(100);   
+    DelayMs(1);
+
+    /* registers are back to their defaults, RAM is kept */
+    retained.awake = 0;
+    retained.mode = EPD_MODE_NONE;
+    if (ReadBusy() != 0) {
+        return -1;
+    }
+    retained.awake = 1;
+    return 0;
+}
+
+/**
+ *  @brief: what the controller was last configured with, kept in RTC memory
+ *          so a wake can skip re-sending the same init and LUT. Valid for as
+ *          long as the controller is left in standby between refreshes
+ *          rather than put into deep sleep, which needs a reset to leave
+ */
+bool Epd::Retained(unsigned char mode, unsigned int param) {
+    CheckRetained();
+    return retained.awake && retained.mode == mode && retained.param == param;
+}
+
+void Epd::Retain(unsigned char mode, unsigned int param) {
+    retained.mode = mode;
+    retained.param = param;
+}
+
+/**
+ *  @brief: RAM plane contents, kept in RTC memory alongside the rest. Resets
+ *          and deep sleep keep RAM, only a power cycle loses it, and that
+ *          clears RTC memory too. Chain calls to PlaneCrc() with the last
+ *          result for a plane written in pieces
+ */
+uint32_t Epd::PlaneCrc(const unsigned char* data, unsigned int len, uint32_t crc) {
+    return esp_rom_crc32_le(crc, data, len);
+}
+
+bool Epd::PlaneHolds(unsigned char ram, uint32_t crc) {
+    const int i = (ram == 0x26);
+    return (retained.planes & (1 << i)) && retained.plane_crc[i] == crc;
+}
+
+bool Epd::PlanesMatch(void) {
+    return retained.planes == 0x03 && retained.plane_crc[0] == retained.plane_crc[1];
+}
+
+void Epd::PlaneWritten(unsigned char ram, uint32_t crc) {
+    const int i = (ram == 0x26);
+    retained.planes |= (1 << i);
+    retained.plane_crc[i] = crc;
+}
+
+/**
+ *  @brief: call before a plane is written in part or in a way not worth
+ *          tracking, and after refreshes that may rewrite 0x26 themselves
+ */
+void Epd::PlaneChanged(unsigned char ram) {
+    retained.planes &= ~(1 << (ram == 0x26));
+}
+
+/**
+ *  @brief: writes a whole RAM plane unless it already holds crc
+ */
+void Epd::WritePlane(unsigned char ram, const unsigned char* data, unsigned int len, uint32_t crc) {
+    if (PlaneHolds(ram, crc)) {
+        return;
+    }
+    PlaneChanged(ram);
+    SetRamCursor(0, 0);
+    SendCommand(ram);
+    SendDataBuffer(data, len);
+    PlaneWritten(ram, crc);
+}
+
+/**
+ *  @brief: makes sure the controller is out of deep sleep, the caller
+ *          configures it from scratch so what was retained is dropped
+ */
+int Epd::Wake(void) {
+    if (IfInit() != 0) {
+        return -1;
+    }
+    CheckRetained();
+    retained.mode = EPD_MODE_NONE;
+    if (retained.awake) {
+        return 0;
+    }
+    return Reset();
 }
 
 /**
@@ -301,18 +453,27 @@ void Epd::Clear(void)
 	Width = (width % 8 == 0)? (width / 8 ): (width / 8 + 1);
 	Height = height;
 
-	SendCommand(0x24);
+	unsigned char row[EPD_WIDTH / 8];
+	memset(row, 0xff, sizeof(row));
+
+	uint32_t crc = 0;
 	for (unsigned int j = 0; j < Height; j++) {
-        for (unsigned int i = 0; i < Width; i++) {
-            SendData(0xff);
-        }
+        crc = PlaneCrc(row, Width, crc);
 	}
-    SendCommand(0x26);
-    for (unsigned int j = 0; j < Height; j++) {
-        for (unsigned int i = 0; i < Width; i++) {
-            SendData(0xff);
+
+    const unsigned char planes[2] = { 0x24, 0x26 };
+    for (int i = 0; i < 2; i++) {
+        if (PlaneHolds(planes[i], crc)) {
+            continue;
         }
-	}
+        PlaneChanged(planes[i]);
+        SetRamCursor(0, 0);
+        SendCommand(planes[i]);
+        for (unsigned int j = 0; j < Height; j++) {
+            SendDataBuffer(row, Width);
+        }
+        PlaneWritten(planes[i], crc);
+    }
 	TurnOnDisplay();
 }
 
@@ -322,18 +483,9 @@ void Epd::Display(const unsigned char* Image)
 	Width = (width % 8 == 0)? (width / 8 ): (width / 8 + 1);
 	Height = height;
 
-	SendCommand(0x24);
-	for (unsigned int j = 0; j < Height; j++) {
-        for (unsigned int i = 0; i < Width; i++) {
-            SendData(pgm_read_byte(&Image[i + j * Width]));
-        }
-	}
-    SendCommand(0x26);
-    for (unsigned int j = 0; j < Height; j++) {
-        for (unsigned int i = 0; i < Width; i++) {
-            SendData(pgm_read_byte(&Image[i + j * Width]));
-        }
-	}
+	const uint32_t crc = PlaneCrc(Image, Width * Height);
+	WritePlane(0x24, Image, Width * Height, crc);
+	WritePlane(0x26, Image, Width * Height, crc);
 	TurnOnDisplay();
 }
 
@@ -343,18 +495,9 @@ void Epd::Display_Fast(const unsigned char* Image)
 	Width = (width % 8 == 0)? (width / 8 ): (width / 8 + 1);
 	Height = height;
 
-	SendCommand(0x24);
-	for (unsigned int j = 0; j < Height; j++) {
-        for (unsigned int i = 0; i < Width; i++) {
-            SendData(pgm_read_byte(&Image[i + j * Width]));
-        }
-	}
-    SendCommand(0x26);
-	for (unsigned int j = 0; j < Height; j++) {
-        for (unsigned int i = 0; i < Width; i++) {
-            SendData(pgm_read_byte(&Image[i + j * Width]));
-        }
-	}
+	const uint32_t crc = PlaneCrc(Image, Width * Height);
+	WritePlane(0x24, Image, Width * Height, crc);
+	WritePlane(0x26, Image, Width * Height, crc);
 	TurnOnDisplay_Fast();
 }
 
@@ -364,25 +507,16 @@ void Epd::Display_Base(const unsigned char* Image)
 	Width = (width % 8 == 0)? (width / 8 ): (width / 8 + 1);
 	Height = height;
 
-	SendCommand(0x24);   //Write Black and White image to RAM
-	for (unsigned int j = 0; j < Height; j++) {
-        for (unsigned int i = 0; i < Width; i++) {
-            SendData(pgm_read_byte(&Image[i + j * Width]));
-        }
-	}
-	SendCommand(0x26);   //Write Black and White image to RAM
-	for (unsigned int j = 0; j < Height; j++) {
-        for (unsigned int i = 0; i < Width; i++) {
-            SendData(pgm_read_byte(&Image[i + j * Width]));
-        }
-	}
+	const uint32_t crc = PlaneCrc(Image, Width * Height);
+	WritePlane(0x24, Image, Width * Height, crc);   //Write Black and White image to RAM
+	WritePlane(0x26, Image, Width * Height, crc);   //Write Black and White image to RAM
 	TurnOnDisplay();	
 }
 
 void Epd::Display_Partial(unsigned char* Image, unsigned int  Xstart, unsigned int  Ystart, unsigned int  Xend, unsigned int  Yend)
 {
 
-    unsigned int  i, Width;
+    unsigned int  Width;
     unsigned int  IMAGE_COUNTER;
 
     if((Xstart % 8 + Xend % 8 == 8 && Xstart % 8 > Xend % 8) || Xstart % 8 + Xend % 8 == 0 || (Xend - Xstart)%8 == 0)
@@ -431,17 +565,17 @@ void Epd::Display_Partial(unsigned char* Image, unsigned int  Xstart, unsigned i
 	SendData((Ystart>>8) & 0x01);
 
 
+	PlaneChanged(0x24);
+	PlaneChanged(0x26);
 	SendCommand(0x24);   //Write Black and White image to RAM
-	for (i = 0; i < IMAGE_COUNTER; i++) {
-		SendData(Image[i]);
-	}
+	SendDataBuffer(Image, IMAGE_COUNTER);
 	TurnOnDisplay_Partial();
 }
 
 void Epd::Display_Partial_Not_refresh(unsigned char* Image, unsigned int  Xstart, unsigned int  Ystart, unsigned int  Xend, unsigned int  Yend)
 {
 
-    unsigned int  i, Width;
+    unsigned int  Width;
     unsigned int  IMAGE_COUNTER;
 
     if((Xstart % 8 + Xend % 8 == 8 && Xstart % 8 > Xend % 8) || Xstart % 8 + Xend % 8 == 0 || (Xend - Xstart)%8 == 0)
@@ -490,125 +624,68 @@ void Epd::Display_Partial_Not_refresh(unsigned char* Image, unsigned int  Xstart
 	SendData((Ystart>>8) & 0x01);
 
 
+	PlaneChanged(0x24);
 	SendCommand(0x24);   //Write Black and White image to RAM
-	for (i = 0; i < IMAGE_COUNTER; i++) {
-		SendData(Image[i]);
-	}
+	SendDataBuffer(Image, IMAGE_COUNTER);
 	// TurnOnDisplay_Partial();
 }
 
-void Epd::Set_4GrayDisplay(const unsigned char *Image, int x, int y, int w, int l)
+/**
+ *  @brief: 2bpp byte (4 pixels) to its bits in both 4-gray RAM planes,
+ *          0x24 plane in the high nibble, 0x26 plane in the low nibble
+ *
+ *        white  gray1  gray2  black
+ *  0x24|  1      1      0      0       pixel bit 1
+ *  0x26|  1      0      1      0       pixel bit 0
+ */
+static const unsigned char GRAY4_PLANES[256] = {
+    0x00, 0x01, 0x10, 0x11, 0x02, 0x03, 0x12, 0x13, 0x20, 0x21, 0x30, 0x31, 0x22, 0x23, 0x32, 0x33,
+    0x04, 0x05, 0x14, 0x15, 0x06, 0x07, 0x16, 0x17, 0x24, 0x25, 0x34, 0x35, 0x26, 0x27, 0x36, 0x37,
+    0x40, 0x41, 0x50, 0x51, 0x42, 0x43, 0x52, 0x53, 0x60, 0x61, 0x70, 0x71, 0x62, 0x63, 0x72, 0x73,
+    0x44, 0x45, 0x54, 0x55, 0x46, 0x47, 0x56, 0x57, 0x64, 0x65, 0x74, 0x75, 0x66, 0x67, 0x76, 0x77,
+    0x08, 0x09, 0x18, 0x19, 0x0A, 0x0B, 0x1A, 0x1B, 0x28, 0x29, 0x38, 0x39, 0x2A, 0x2B, 0x3A, 0x3B,
+    0x0C, 0x0D, 0x1C, 0x1D, 0x0E, 0x0F, 0x1E, 0x1F, 0x2C, 0x2D, 0x3C, 0x3D, 0x2E, 0x2F, 0x3E, 0x3F,
+    0x48, 0x49, 0x58, 0x59, 0x4A, 0x4B, 0x5A, 0x5B, 0x68, 0x69, 0x78, 0x79, 0x6A, 0x6B, 0x7A, 0x7B,
+    0x4C, 0x4D, 0x5C, 0x5D, 0x4E, 0x4F, 0x5E, 0x5F, 0x6C, 0x6D, 0x7C, 0x7D, 0x6E, 0x6F, 0x7E, 0x7F,
+    0x80, 0x81, 0x90, 0x91, 0x82, 0x83, 0x92, 0x93, 0xA0, 0xA1, 0xB0, 0xB1, 0xA2, 0xA3, 0xB2, 0xB3,
+    0x84, 0x85, 0x94, 0x95, 0x86, 0x87, 0x96, 0x97, 0xA4, 0xA5, 0xB4, 0xB5, 0xA6, 0xA7, 0xB6, 0xB7,
+    0xC0, 0xC1, 0xD0, 0xD1, 0xC2, 0xC3, 0xD2, 0xD3, 0xE0, 0xE1, 0xF0, 0xF1, 0xE2, 0xE3, 0xF2, 0xF3,
+    0xC4, 0xC5, 0xD4, 0xD5, 0xC6, 0xC7, 0xD6, 0xD7, 0xE4, 0xE5, 0xF4, 0xF5, 0xE6, 0xE7, 0xF6, 0xF7,
+    0x88, 0x89, 0x98, 0x99, 0x8A, 0x8B, 0x9A, 0x9B, 0xA8, 0xA9, 0xB8, 0xB9, 0xAA, 0xAB, 0xBA, 0xBB,
+    0x8C, 0x8D, 0x9C, 0x9D, 0x8E, 0x8F, 0x9E, 0x9F, 0xAC, 0xAD, 0xBC, 0xBD, 0xAE, 0xAF, 0xBE, 0xBF,
+    0xC8, 0xC9, 0xD8, 0xD9, 0xCA, 0xCB, 0xDA, 0xDB, 0xE8, 0xE9, 0xF8, 0xF9, 0xEA, 0xEB, 0xFA, 0xFB,
+    0xCC, 0xCD, 0xDC, 0xDD, 0xCE, 0xCF, 0xDE, 0xDF, 0xEC, 0xED, 0xFC, 0xFD, 0xEE, 0xEF, 0xFE, 0xFF,
+};
+
+void Epd::Gray4ToPlanes(const unsigned char* in, int n, unsigned char* plane_24, unsigned char* plane_26)
+{
+    for (int i = 0; i < n; i++) {
+        const unsigned char a = GRAY4_PLANES[in[2 * i]];
+        const unsigned char b = GRAY4_PLANES[in[2 * i + 1]];
+        plane_24[i] = (a & 0xF0) | (b >> 4);
+        plane_26[i] = (a << 4) | (b & 0x0F);
+    }
+}
+
+/**
+ *  @brief: point the RAM address counter at byte x of row y
+ */
+void Epd::SetRamCursor(unsigned int x, unsigned int y)
 {
-    int i,j,k,m;
-	int z=0;
-    unsigned char temp1,temp2,temp3;
-/****Color display description****
-      white  gray1  gray2  black
-0x10|  01     01     00     00
-0x13|  01     00     01     00
-*********************************/
-	SendCommand(0x24);
-	z=0;
-	x= x/8*8;
-	for(m = 0; m<EPD_HEIGHT;m++)
-		for(i=0;i<EPD_WIDTH/8;i++)
-		{
-			if(i >= x/8 && i <(x+w)/8 && m >= y && m < y+l){
-				
-				temp3=0;
-				for(j=0;j<2;j++)	
-				{
-					temp1 = pgm_read_byte(&Image[z*2+j]);
-					for(k=0;k<2;k++)	
-					{
-						temp2 = temp1&0xC0 ;
-						if(temp2 == 0xC0)
-							temp3 |= 0x01;//white
-						else if(temp2 == 0x00)
-							temp3 |= 0x00;  //black
-						else if(temp2 == 0x80) 
-							temp3 |= 0x01;  //gray1
-						else //0x40
-							temp3 |= 0x00; //gray2
-						temp3 <<= 1;	
-						
-						temp1 <<= 2;
-						temp2 = temp1&0xC0 ;
-						if(temp2 == 0xC0)  //white
-							temp3 |= 0x01;
-						else if(temp2 == 0x00) //black
-							temp3 |= 0x00;
-						else if(temp2 == 0x80)
-							temp3 |= 0x01; //gray1
-						else    //0x40
-								temp3 |= 0x00;	//gray2	
-						if(j!=1 || k!=1)				
-							temp3 <<= 1;
-						
-						temp1 <<= 2;
-					}
-				}
-				z++;
-				SendData(temp3);
-				
-			}else{
-				SendData(0xff);
-			}				
-		}
-    // new  data
-    SendCommand(0x26);
-	z=0;
-	for(m = 0; m<EPD_HEIGHT;m++)
-		for(i=0;i<EPD_WIDTH/8;i++)
-		{
-			if(i >= x/8 && i <(x+w)/8 && m >= y && m < y+l){
-				
-				temp3=0;
-				for(j=0;j<2;j++)	
-				{
-					temp1 = pgm_read_byte(&Image[z*2+j]);
-					for(k=0;k<2;k++)	
-					{
-						temp2 = temp1&0xC0 ;
-						if(temp2 == 0xC0)
-							temp3 |= 0x01;//white
-						else if(temp2 == 0x00)
-							temp3 |= 0x00;  //black
-						else if(temp2 == 0x80) 
-							temp3 |= 0x00;  //gray1
-						else //0x40
-							temp3 |= 0x01; //gray2
-						temp3 <<= 1;	
-						
-						temp1 <<= 2;
-						temp2 = temp1&0xC0 ;
-						if(temp2 == 0xC0)  //white
-							temp3 |= 0x01;
-						else if(temp2 == 0x00) //black
-							temp3 |= 0x00;
-						else if(temp2 == 0x80)
-							temp3 |= 0x00; //gray1
-						else    //0x40
-								temp3 |= 0x01;	//gray2
-						if(j!=1 || k!=1)					
-							temp3 <<= 1;
-						
-						temp1 <<= 2;
-					}
-				}
-				z++;
-				SendData(temp3);	
-			}else {
-				SendData(0xff);	
-			}
-		}
-    TurnOnDisplay_4Gray();
+    SendCommand(0x4E);
+    SendData(x & 0xFF);
+
+    SendCommand(0x4F);
+    SendData(y & 0xFF);
+    SendData((y >> 8) & 0x01);
 }
 
 void Epd::Sleep() {
     SendCommand(0x10);  
     SendData(0x01);        
     DelayMs(100);          
+    retained.awake = 0;
+    retained.mode = EPD_MODE_NONE;
 }
 
 const unsigned char LUT_ALL[233]={							
@@ -648,5 +725,83 @@ const unsigned char LUT_ALL[233]={
 0x32,	0x30,						
 };	
 
+/* LUT_ALL with the first flashing group run once instead of 5 times, it
+   nets to zero DC on its own; the second one evens out the rest and stays */
+const unsigned char LUT_4GRAY_SHORT[EPD_LUT_BYTES]={
+0x01,	0x0A,	0x1B,	0x0F,	0x03,	0x01,	0x01,	
+0x01,	0x0A,	0x01,	0x0A,	0x01,	0x01,	0x01,	
+0x05,	0x08,	0x03,	0x02,	0x04,	0x01,	0x01,	
+0x01,	0x04,	0x04,	0x02,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x0A,	0x1B,	0x0F,	0x03,	0x01,	0x01,	
+0x01,	0x4A,	0x01,	0x8A,	0x01,	0x01,	0x01,	
+0x05,	0x48,	0x03,	0x82,	0x84,	0x01,	0x01,	
+0x01,	0x84,	0x84,	0x82,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x0A,	0x1B,	0x8F,	0x03,	0x01,	0x01,	
+0x01,	0x4A,	0x01,	0x8A,	0x01,	0x01,	0x01,	
+0x05,	0x48,	0x83,	0x82,	0x04,	0x01,	0x01,	
+0x01,	0x04,	0x04,	0x02,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x8A,	0x1B,	0x8F,	0x03,	0x01,	0x01,	
+0x01,	0x4A,	0x01,	0x8A,	0x01,	0x01,	0x01,	
+0x05,	0x48,	0x83,	0x02,	0x04,	0x01,	0x01,	
+0x01,	0x04,	0x04,	0x02,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x8A,	0x9B,	0x8F,	0x03,	0x01,	0x01,	
+0x01,	0x4A,	0x01,	0x8A,	0x01,	0x01,	0x01,	
+0x05,	0x48,	0x03,	0x42,	0x04,	0x01,	0x01,	
+0x01,	0x04,	0x04,	0x42,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x00,	0x00,	0x00,	0x00,	0x00,	0x00,	0x00,	
+0x00,	0x00,	0x00,	0x00,	0x00,	0x00,	0x00,	
+0x02,	0x00,	0x00,	0x07,	0x17,	0x41,	0xA8,	
+0x32,	0x30,	
+};
+
+/* LUT_4GRAY_SHORT with both greys driven by the darker grey's LUT, for
+   black, white and a single grey */
+const unsigned char LUT_GRAY2[EPD_LUT_BYTES]={
+0x01,	0x0A,	0x1B,	0x0F,	0x03,	0x01,	0x01,	
+0x01,	0x0A,	0x01,	0x0A,	0x01,	0x01,	0x01,	
+0x05,	0x08,	0x03,	0x02,	0x04,	0x01,	0x01,	
+0x01,	0x04,	0x04,	0x02,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x0A,	0x1B,	0x0F,	0x03,	0x01,	0x01,	
+0x01,	0x4A,	0x01,	0x8A,	0x01,	0x01,	0x01,	
+0x05,	0x48,	0x03,	0x82,	0x84,	0x01,	0x01,	
+0x01,	0x84,	0x84,	0x82,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x0A,	0x1B,	0x0F,	0x03,	0x01,	0x01,	
+0x01,	0x4A,	0x01,	0x8A,	0x01,	0x01,	0x01,	
+0x05,	0x48,	0x03,	0x82,	0x84,	0x01,	0x01,	
+0x01,	0x84,	0x84,	0x82,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x8A,	0x1B,	0x8F,	0x03,	0x01,	0x01,	
+0x01,	0x4A,	0x01,	0x8A,	0x01,	0x01,	0x01,	
+0x05,	0x48,	0x83,	0x02,	0x04,	0x01,	0x01,	
+0x01,	0x04,	0x04,	0x02,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x8A,	0x9B,	0x8F,	0x03,	0x01,	0x01,	
+0x01,	0x4A,	0x01,	0x8A,	0x01,	0x01,	0x01,	
+0x05,	0x48,	0x03,	0x42,	0x04,	0x01,	0x01,	
+0x01,	0x04,	0x04,	0x42,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x01,	0x00,	0x00,	0x00,	0x00,	0x01,	0x01,	
+0x00,	0x00,	0x00,	0x00,	0x00,	0x00,	0x00,	
+0x00,	0x00,	0x00,	0x00,	0x00,	0x00,	0x00,	
+0x02,	0x00,	0x00,	0x07,	0x17,	0x41,	0xA8,	
+0x32,	0x30,	
+};
+
 
 /* END OF FILE */
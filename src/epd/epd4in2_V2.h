@@ -36,24 +36,40 @@
 #define Seconds_1_5S      0
 #define Seconds_1S        1
 
+// what the controller was last configured for, see Epd::Retained()
+#define EPD_MODE_NONE     0
+#define EPD_MODE_FULL     1
+#define EPD_MODE_FAST     2
+#define EPD_MODE_4GRAY    3
+
+// 0x32 waveform, then the 0x3F, 0x03, 0x04 and 0x2C bytes, see Epd::Lut()
+#define EPD_LUT_BYTES     233
+
 
 extern const unsigned char LUT_ALL[];
+extern const unsigned char LUT_4GRAY_SHORT[];
+extern const unsigned char LUT_GRAY2[];
 
 class Epd : EpdIf {
 public:
     unsigned int width;
     unsigned int height;
+    unsigned long busy_ms;          // last ReadBusy()
+    unsigned long busy_ms_total;    // every ReadBusy() since construction
 
     Epd();
     ~Epd();
     int  Init(void);
     int  Init_Fast(char mode);
-    void Lut(void);
-	int  Init_4Gray(void);
+    void Lut(const unsigned char* lut = LUT_ALL);
+	int  Init_4Gray(const unsigned char* lut = LUT_ALL, unsigned int lut_id = 0);
     void SendCommand(unsigned char command);
     void SendData(unsigned char data);
-    void ReadBusy(void);
-    void Reset(void);
+    void SendDataBuffer(const unsigned char* data, unsigned int len);
+    int  ReadBusy(void);
+    int  Reset(void);
+    int  Wake(void);
+    bool Retained(unsigned char mode, unsigned int param);
     void TurnOnDisplay(void);
     void TurnOnDisplay_Fast(void);
     void TurnOnDisplay_Partial(void);
@@ -64,12 +80,25 @@ public:
     void Display_Base(const unsigned char* Image);
     void Display_Partial(unsigned char* Image, unsigned int  Xstart, unsigned int  Ystart, unsigned int  Xend, unsigned int  Yend);
     void Display_Partial_Not_refresh(unsigned char* Image, unsigned int  Xstart, unsigned int  Ystart, unsigned int  Xend, unsigned int  Yend);
-    void Set_4GrayDisplay(const unsigned char *Image, int x, int y, int w, int l);
     void Sleep(void);
+
+    // n pairs of 2bpp bytes to n bytes of each 4-gray RAM plane
+    static void Gray4ToPlanes(const unsigned char* in, int n, unsigned char* plane_24, unsigned char* plane_26);
+
+    // what each RAM plane (0x24 / 0x26) holds, as a CRC-32 of the whole plane
+    static uint32_t PlaneCrc(const unsigned char* data, unsigned int len, uint32_t crc = 0);
+    static bool PlaneHolds(unsigned char ram, uint32_t crc);
+    static bool PlanesMatch(void);
+    static void PlaneWritten(unsigned char ram, uint32_t crc);
+    static void PlaneChanged(unsigned char ram);
 	
 	
 
 private:
+    void SetRamCursor(unsigned int x, unsigned int y);
+    void Retain(unsigned char mode, unsigned int param);
+    void WritePlane(unsigned char ram, const unsigned char* data, unsigned int len, uint32_t crc);
+
     unsigned int reset_pin;
     unsigned int dc_pin;
     unsigned int cs_pin;
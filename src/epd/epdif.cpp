@@ -27,8 +27,12 @@
 
 #include "epdif.h"
 #include <SPI.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
 
 static bool spi_initialized = false;
+static unsigned long spi_clock_hz = SPI_CLOCK_HZ;
+static bool busy_sleep = false;
 
 EpdIf::EpdIf() {
 };
@@ -54,15 +58,112 @@ void EpdIf::SpiTransfer(unsigned char data) {
     digitalWrite(CS_PIN, HIGH);
 }
 
+/**
+ *  @brief: streams a whole buffer in one chip select, the controller only
+ *          latches a byte per 8 clocks so CS doesn't need to bounce between them
+ */
+void EpdIf::SpiWriteBuffer(const unsigned char* data, unsigned int len) {
+    digitalWrite(CS_PIN, LOW);
+    SPI.writeBytes(data, len);
+    digitalWrite(CS_PIN, HIGH);
+}
+
+/**
+ *  @brief: hands the SPI bus back so another driver can claim it,
+ *          the next IfInit() begins it again
+ */
+void EpdIf::SpiRelease(void) {
+    if (spi_initialized) {
+        SPI.endTransaction();
+        SPI.end();
+        spi_initialized = false;
+    }
+}
+
+/**
+ *  @brief: write clock for this and any later transaction
+ */
+void EpdIf::SetSpiClock(unsigned long hz) {
+    spi_clock_hz = hz;
+    if (spi_initialized) {
+        SPI.endTransaction();
+        SPI.beginTransaction(SPISettings(spi_clock_hz, MSBFIRST, SPI_MODE0));
+    }
+}
+
+unsigned long EpdIf::GetSpiClock(void) {
+    return spi_clock_hz;
+}
+
+void EpdIf::SetBusySleep(bool enable) {
+    busy_sleep = enable;
+}
+
+/**
+ *  @brief: waits for pin to go LOW. Past the first few ms the chip light
+ *          sleeps, woken by the pin itself or by the timeout
+ */
+int EpdIf::WaitLow(int pin, unsigned int timeout_ms, unsigned long* waited_ms) {
+    const unsigned long start = millis();
+    /* wakeup sources take a GPIO number, pin is the board's Arduino number */
+    const gpio_num_t gpio = (gpio_num_t) digitalPinToGPIONumber(pin);
+    int rc = 0;
+
+    while (digitalRead(pin) == HIGH) {
+        const unsigned long elapsed = millis() - start;
+        if (elapsed >= timeout_ms) {
+            rc = -1;
+            break;
+        }
+
+        if (!busy_sleep || elapsed < BUSY_SPIN_MS)
+            continue;
+
+        // the UART stops in light sleep
+        Serial.flush();
+
+        gpio_wakeup_enable(gpio, GPIO_INTR_LOW_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+        esp_sleep_enable_timer_wakeup((uint64_t) (timeout_ms - elapsed) * 1000);
+        esp_light_sleep_start();
+        esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+        esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+        gpio_wakeup_disable(gpio);
+    }
+
+    if (waited_ms)
+        *waited_ms = millis() - start;
+    return rc;
+}
+
+/**
+ *  @brief: keeps RST and CS high through deep sleep, the controller is left
+ *          in standby and floating lines would reset it or clock into it.
+ *          IfInit() lets go of them
+ */
+void EpdIf::HoldPins(void) {
+    digitalWrite(CS_PIN, HIGH);
+    digitalWrite(RST_PIN, HIGH);
+    gpio_hold_en((gpio_num_t) digitalPinToGPIONumber(CS_PIN));
+    gpio_hold_en((gpio_num_t) digitalPinToGPIONumber(RST_PIN));
+    gpio_deep_sleep_hold_en();
+}
+
 int EpdIf::IfInit(void) {
+    /* the output latch comes back low from deep sleep, RST low would hold
+       the controller in reset, so the level is set before the direction */
+    digitalWrite(CS_PIN, HIGH);
+    digitalWrite(RST_PIN, HIGH);
     pinMode(CS_PIN, OUTPUT);
     pinMode(RST_PIN, OUTPUT);
     pinMode(DC_PIN, OUTPUT);
     pinMode(BUSY_PIN, INPUT); 
+    gpio_hold_dis((gpio_num_t) digitalPinToGPIONumber(CS_PIN));
+    gpio_hold_dis((gpio_num_t) digitalPinToGPIONumber(RST_PIN));
 
     if (!spi_initialized) {
         SPI.begin();
-        SPI.beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
+        SPI.beginTransaction(SPISettings(spi_clock_hz, MSBFIRST, SPI_MODE0));
         spi_initialized = true;
     }
     return 0;
@@ -36,6 +36,12 @@
 #define CS_PIN          10
 #define BUSY_PIN        7
 
+#define SPI_CLOCK_HZ    2000000         // default write clock, known good on every unit
+
+// BUSY waits give up after the timeout, ones outlasting the spin sleep
+#define BUSY_TIMEOUT_MS 10000
+#define BUSY_SPIN_MS    5
+
 class EpdIf {
 public:
     EpdIf(void);
@@ -46,6 +52,13 @@ public:
     static int  DigitalRead(int pin);
     static void DelayMs(unsigned int delaytime);
     static void SpiTransfer(unsigned char data);
+    static void SpiWriteBuffer(const unsigned char* data, unsigned int len);
+    static void SpiRelease(void);
+    static void SetSpiClock(unsigned long hz);
+    static unsigned long GetSpiClock(void);
+    static int  WaitLow(int pin, unsigned int timeout_ms, unsigned long* waited_ms);
+    static void SetBusySleep(bool enable);
+    static void HoldPins(void);
 };
 
 #endif
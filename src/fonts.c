@@ -2,8 +2,15 @@
 
 #include "fonts.h"
 
+#include "ttf_render.h"
+
 const
 #include "fonts/notoserif_regular_ttf.h"
 
 const
-#include "fonts/notoserif_bold_ttf.h"
\ No newline at end of file
+#include "fonts/notoserif_bold_ttf.h"
+
+#include "fonts/notoserif_regular_kern.h"
+#include "fonts/notoserif_bold_kern.h"
+
+#include "fonts/notoserif_regular_144_atlas.h"
\ No newline at end of file
@@ -3,7 +3,15 @@
 #ifndef __PAPER_FONTS_H__
 #define __PAPER_FONTS_H__
 
+#include <stdint.h>
+
 extern const unsigned char notoserif_regular_ttf[];
 extern const unsigned char notoserif_bold_ttf[];
 
+extern const int16_t notoserif_regular_kern[];
+extern const int16_t notoserif_bold_kern[];
+
+struct TTF_atlas;
+extern const struct TTF_atlas notoserif_regular_144_atlas;
+
 #endif // __PAPER_FONTS_H__
\ No newline at end of file
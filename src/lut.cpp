@@ -0,0 +1,222 @@
+// lut.cpp
+
+#include "lut.hpp"
+
+#include "epd/epd4in2_V2.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+
+
+
+namespace paper {
+
+// 5 LUTs, one per RAM bit pair then VCOM, of 6 groups: a repeat count, phases A-D as
+// voltage << 6 | frames and 2 more bytes. The rest of the table is left as stock.
+static constexpr int        LUT_COUNT           = 5;
+static constexpr int        GROUP_COUNT         = 6;
+static constexpr int        GROUP_BYTES         = 7;
+static constexpr int        WAVEFORM_BYTES      = LUT_COUNT * GROUP_COUNT * GROUP_BYTES;
+
+// a phase's voltage select
+static constexpr int        LEVEL_VSS           = 0;
+static constexpr int        LEVEL_VSH1          = 1;
+static constexpr int        LEVEL_VSL           = 2;
+static constexpr int        LEVEL_VSH2          = 3;
+
+static constexpr int        FILE_HEADER_BYTES   = 8;
+static constexpr uint8_t    FILE_VERSION        = 1;
+static const char*          FILE_MAGIC          = "EPDL";
+
+static const char*          NVS_NAMESPACE       = "lut";
+static const char*          KEY_CUSTOM          = "custom";
+
+static const char*          NAMES[WAVEFORM_COUNT] = { "standard", "short", "grey2", "custom" };
+
+// read out of flash on first use, uploads stream straight from it
+static uint8_t              custom[EPD_LUT_BYTES];
+static bool                 custom_loaded = false;
+
+static_assert(LUT_FILE_BYTES == FILE_HEADER_BYTES + EPD_LUT_BYTES + 4, "waveform file layout");
+
+static int parse(const uint8_t* file, int len, const uint8_t** data)
+{
+    if (len != LUT_FILE_BYTES) {
+        Serial.printf("Error: Waveform file is %d bytes, expected %d.\n", len, LUT_FILE_BYTES);
+        return -1;
+    }
+
+    if (memcmp(file, FILE_MAGIC, 4) != 0 || file[4] != FILE_VERSION) {
+        Serial.print("Error: Not a version 1 waveform file.\n");
+        return -1;
+    }
+
+    const uint8_t* tail = file + LUT_FILE_BYTES - 4;
+    const uint32_t crc = tail[0] | (tail[1] << 8) | (tail[2] << 16) | ((uint32_t) tail[3] << 24);
+    if (esp_rom_crc32_le(0, file, LUT_FILE_BYTES - 4) != crc) {
+        Serial.print("Error: Waveform file CRC mismatch.\n");
+        return -1;
+    }
+
+    *data = file + FILE_HEADER_BYTES;
+    return lut_check(*data);
+}
+
+static int load_custom()
+{
+    if (custom_loaded)
+        return 0;
+
+    uint8_t file[LUT_FILE_BYTES];
+    size_t len = 0;
+
+    Preferences nvs;
+    if (nvs.begin(NVS_NAMESPACE, true)) {
+        len = nvs.getBytes(KEY_CUSTOM, file, sizeof(file));
+        nvs.end();
+    }
+
+    if (!len) {
+        Serial.print("Error: No custom waveform loaded.\n");
+        return -1;
+    }
+
+    const uint8_t* data;
+    if (parse(file, (int) len, &data))
+        return -1;
+
+    memcpy(custom, data, EPD_LUT_BYTES);
+    custom_loaded = true;
+    return 0;
+}
+
+int lut_frames(const uint8_t* data)
+{
+    // the LUTs play out side by side, the longest sets the refresh time
+    int longest = 0;
+    for (int i = 0; i < LUT_COUNT; i++) {
+        int frames = 0;
+        for (int j = 0; j < GROUP_COUNT; j++) {
+            const uint8_t* group = data + (i * GROUP_COUNT + j) * GROUP_BYTES;
+            const int phase_frames = (group[1] & 0x3F) + (group[2] & 0x3F) +
+                (group[3] & 0x3F) + (group[4] & 0x3F);
+            frames += group[0] * phase_frames;
+        }
+
+        if (frames > longest)
+            longest = frames;
+    }
+
+    return longest;
+}
+
+int lut_check(const uint8_t* data)
+{
+    // gate, source and VCOM voltages among them, the panel isn't rated for any other drive
+    if (memcmp(data + WAVEFORM_BYTES, LUT_ALL + WAVEFORM_BYTES, EPD_LUT_BYTES - WAVEFORM_BYTES) != 0) {
+        Serial.print("Error: Waveform settings past the LUT groups differ from stock.\n");
+        return -1;
+    }
+
+    // VSH1 and VSL match in magnitude, so every LUT's frames at each have to cancel out, as in
+    // all the stock ones; VSH2 sits lower and stock never drives it
+    for (int i = 0; i < LUT_COUNT; i++) {
+        int dc_frames = 0;
+        for (int j = 0; j < GROUP_COUNT; j++) {
+            const uint8_t* group = data + (i * GROUP_COUNT + j) * GROUP_BYTES;
+            for (int k = 1; k <= 4; k++) {
+                const int level = group[k] >> 6;
+                const int frames = group[0] * (group[k] & 0x3F);
+                if (level == LEVEL_VSH2 && frames) {
+                    Serial.printf("Error: Waveform LUT %d drives VSH2.\n", i);
+                    return -1;
+                }
+
+                if (level == LEVEL_VSH1)
+                    dc_frames += frames;
+                else if (level == LEVEL_VSL)
+                    dc_frames -= frames;
+            }
+        }
+
+        if (dc_frames) {
+            Serial.printf("Error: Waveform LUT %d is DC unbalanced by %d frames.\n", i, dc_frames);
+            return -1;
+        }
+    }
+
+    // also keeps the refresh well inside the BUSY timeout
+    const int frames = lut_frames(data);
+    const int max_frames = lut_frames(LUT_ALL);
+    if (frames < 1 || frames > max_frames) {
+        Serial.printf("Error: Waveform runs %d frames, must be 1 to %d.\n", frames, max_frames);
+        return -1;
+    }
+
+    return 0;
+}
+
+int lut_get(Waveform waveform, Lut* lut)
+{
+    int rc = 0;
+    switch (waveform) {
+        case WAVEFORM_STANDARD: lut->data = LUT_ALL; break;
+        case WAVEFORM_SHORT:    lut->data = LUT_4GRAY_SHORT; break;
+        case WAVEFORM_GREY2:    lut->data = LUT_GRAY2; break;
+        case WAVEFORM_CUSTOM:
+            rc = load_custom();
+            lut->data = custom;
+            break;
+        default:
+            Serial.printf("Error: Invalid waveform %d.\n", (int) waveform);
+            rc = -1;
+            break;
+    }
+
+    if (rc == 0)
+        rc = lut_check(lut->data);
+
+    lut->waveform = waveform;
+    if (rc) {
+        lut->waveform = WAVEFORM_STANDARD;
+        lut->data = LUT_ALL;
+    }
+
+    lut->id = esp_rom_crc32_le(0, lut->data, EPD_LUT_BYTES);
+    return rc;
+}
+
+int lut_store(const uint8_t* file, int len)
+{
+    const uint8_t* data;
+    if (parse(file, len, &data))
+        return -1;
+
+    Preferences nvs;
+    if (!nvs.begin(NVS_NAMESPACE)) {
+        Serial.print("Error: NVS\n");
+        return -1;
+    }
+
+    const size_t written = nvs.putBytes(KEY_CUSTOM, file, len);
+    nvs.end();
+    if (written != (size_t) len) {
+        Serial.print("Error: NVS\n");
+        return -1;
+    }
+
+    memcpy(custom, data, EPD_LUT_BYTES);
+    custom_loaded = true;
+    return 0;
+}
+
+const char* lut_name(Waveform waveform)
+{
+    if (waveform < 0 || waveform >= WAVEFORM_COUNT)
+        return "(invalid)";
+
+    return NAMES[waveform];
+}
+
+} // namespace paper
\ No newline at end of file
@@ -0,0 +1,52 @@
+// lut.hpp
+
+#ifndef __PAPER_LUT_HPP__
+#define __PAPER_LUT_HPP__
+
+#include <stdint.h>
+
+
+
+namespace paper {
+
+enum Waveform
+{
+    WAVEFORM_STANDARD,      // the stock 4-gray table
+    WAVEFORM_SHORT,         // 4-gray with the first flashing group cut short
+    WAVEFORM_GREY2,         // black, white and a single grey, as short
+    WAVEFORM_CUSTOM,        // loaded from a file, see lut_store()
+    WAVEFORM_COUNT,
+};
+
+// "EPDL", version, 3 reserved bytes, the table, then a CRC-32 of everything before it,
+// see scripts/lut_pack.py
+static constexpr int LUT_FILE_BYTES = 8 + 233 + 4;
+
+struct Lut
+{
+    Waveform        waveform;       // what was actually picked, after any fallback
+    const uint8_t*  data;           // EPD_LUT_BYTES, laid out as LUT_ALL
+    uint32_t        id;             // CRC-32 of data, tells tables apart for Epd::Init_4Gray()
+};
+
+// the table for waveform, validated, falling back to the standard one and returning -1 if it
+// can't be had
+int lut_get(Waveform waveform, Lut* lut);
+
+// 0 if the table keeps the stock voltages and settings past the LUT groups, drives only the
+// levels the stock LUTs do, nets every LUT to zero DC and runs no longer than stock
+int lut_check(const uint8_t* data);
+
+// frames the longest of the table's LUTs runs for, the refresh time in frames
+int lut_frames(const uint8_t* data);
+
+// validates a waveform file and keeps it in flash as WAVEFORM_CUSTOM
+int lut_store(const uint8_t* file, int len);
+
+const char* lut_name(Waveform waveform);
+
+} // namespace paper
+
+
+
+#endif // __PAPER_LUT_HPP__
\ No newline at end of file
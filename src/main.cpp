@@ -1,5 +1,6 @@
 // main.cpp
 
+#include "display.hpp"
 #include "draw.hpp"
 #include "sync.hpp"
 #include "term.hpp"
@@ -71,6 +72,10 @@ static paper::DrawInfo make_draw_info(const struct tm& time_info, const paper::U
 
     paper::DrawInfo draw_info;
     draw_info.enable_2bpp = user.grey_enabled;
+    draw_info.dither = user.dither;
+    draw_info.waveform = user.waveform;
+    draw_info.partial_limit = user.partial_limit;
+    draw_info.full_refresh_min = user.full_refresh_min;
     draw_info.network_error = sync_failed || user.network_config_required;
     draw_info.time_str = time_str;
     draw_info.date_str = date_str;
@@ -130,8 +135,12 @@ void setup()
 
     const bool sync_required = get_sync_required(first_boot);
 
+    // the first boot keeps the terminal's USB serial up, later ones sleep through refreshes
+    paper::display_set_light_sleep(!first_boot);
+
     paper::user_config_init();
     const paper::UserConfig& user = paper::user_config_get();
+    paper::display_spi_init(user.spi_mhz * 1000000);
 
     if (user.network_config_required) {
         Serial.print("Error: Network config required.\n");
@@ -175,8 +184,17 @@ void setup()
     if (first_boot)
         run_terminal();
 
+    // the last frame has been refreshing in the background
+    {
+        int rc = paper::display_wait();
+        if (rc)
+            Serial.printf("Error: Display failed (%d).\n", rc);
+    }
+
     // go to sleep
     {
+        paper::display_hold_pins();
+
         const int s_until_boot = 60 - paper::get_time_info().tm_sec;
         
         Serial.printf("MAIN    > Sleeping (%d s).\n\n", s_until_boot);
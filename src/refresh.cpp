@@ -0,0 +1,81 @@
+// refresh.cpp
+
+#include "refresh.hpp"
+
+#include "utils.hpp"
+
+#include <Arduino.h>
+
+
+
+namespace paper {
+
+static constexpr float  PARTIAL_MIN_TEMP_C  = 5.f;     // the partial waveform smears below this
+
+struct RefreshState
+{
+    time_t  last_full;          // full quality or 4-gray, 0 if none since power up
+    int     last_full_yday;
+    int     partials;           // since the last whole frame refresh
+};
+
+RTC_DATA_ATTR static RefreshState state = {};
+
+DisplayRefresh refresh_choose(bool enable_2bpp, bool partial_ok, int partial_limit, int full_refresh_min)
+{
+    const time_t now = get_time();
+    const struct tm time_info = to_time_info(now);
+
+    // the chip's own sensor, a few degrees above ambient while awake
+    const float temp_c = temperatureRead();
+
+    const int since_full_min = state.last_full ? (int) ((now - state.last_full) / 60) : -1;
+    Serial.printf("REFRESH > %d partials, %d min since full, %.1f C.\n",
+        state.partials, since_full_min, temp_c);
+
+    if (enable_2bpp)
+        return DISPLAY_REFRESH_GRAY4;
+
+    // a clock going backwards (sync) counts as due too
+    if (!state.last_full || now < state.last_full ||
+        (full_refresh_min > 0 && now - state.last_full >= full_refresh_min * 60) ||
+        time_info.tm_yday != state.last_full_yday)
+        return DISPLAY_REFRESH_FULL;
+
+    if (!partial_ok || state.partials >= partial_limit || temp_c < PARTIAL_MIN_TEMP_C)
+        return DISPLAY_REFRESH_FAST;
+
+    return DISPLAY_REFRESH_PARTIAL;
+}
+
+void refresh_record(DisplayRefresh refresh)
+{
+    switch (refresh) {
+        case DISPLAY_REFRESH_FULL:
+        case DISPLAY_REFRESH_GRAY4:
+            state.last_full = get_time();
+            state.last_full_yday = to_time_info(state.last_full).tm_yday;
+            state.partials = 0;
+            break;
+        case DISPLAY_REFRESH_FAST:
+            state.partials = 0;
+            break;
+        case DISPLAY_REFRESH_PARTIAL:
+            state.partials++;
+            break;
+    }
+}
+
+const char* refresh_name(DisplayRefresh refresh)
+{
+    switch (refresh) {
+        case DISPLAY_REFRESH_PARTIAL:   return "partial";
+        case DISPLAY_REFRESH_FAST:      return "fast";
+        case DISPLAY_REFRESH_FULL:      return "full";
+        case DISPLAY_REFRESH_GRAY4:     return "4-gray";
+    }
+
+    return "?";
+}
+
+} // namespace paper
\ No newline at end of file
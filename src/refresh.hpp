@@ -0,0 +1,25 @@
+// refresh.hpp
+
+#ifndef __PAPER_REFRESH_HPP__
+#define __PAPER_REFRESH_HPP__
+
+#include "display.hpp"
+
+
+
+namespace paper {
+
+// picks this wake's refresh from what has been shown since the last full one,
+// partial_ok says a diff against the panel is possible at all
+DisplayRefresh refresh_choose(bool enable_2bpp, bool partial_ok, int partial_limit, int full_refresh_min);
+
+// call once a refresh has actually been started
+void refresh_record(DisplayRefresh refresh);
+
+const char* refresh_name(DisplayRefresh refresh);
+
+} // namespace paper
+
+
+
+#endif // __PAPER_REFRESH_HPP__
\ No newline at end of file
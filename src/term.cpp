@@ -2,6 +2,10 @@
 
 #include "term.hpp"
 
+#include "composite.h"
+#include "display.hpp"
+#include "epd/epd4in2_V2.h"
+#include "lut.hpp"
 #include "network.hpp"
 #include "posix_tz_db.h"
 #include "sync.hpp"
@@ -25,12 +29,21 @@ static void cmd_help(const char* arg)
         "    set geolocation [on|off] : Enable / disable geolocation.\n"
         "                             : If enabled, overrides time zone code.\n"
         "    set grey [on|off]        : Enable / disable 4-color grey display.\n"
+        "    set dither [off|bayer|atkinson]\n"
+        "                             : Set 2-color dithering.\n"
+        "    set waveform [standard|short|grey2|custom]\n"
+        "                             : Set the 4-color refresh waveform.\n"
+        "    load waveform            : Receive a custom waveform file, see scripts/lut_pack.py.\n"
+        "    set spi [MHz]            : Set the display SPI clock, self-tested.\n"
+        "    set partials [count]     : Partial refreshes between whole ones, 0 for none.\n"
+        "    set fullrefresh [minutes]: Minutes between full refreshes, 0 for daily only.\n"
         "    list timezones           : List all valid time zone codes.\n"
         "    network                  : Test network connection.\n"
         "    reset                    : Clear user configuration.\n"
         "    status                   : Print current user configuration.\n"
         "    sync                     : Connect to network and sync local time.\n"
         "    time                     : Print local time.\n"
+        "    bench                    : Benchmark compositing kernels and SPI uploads.\n"
         "    exit                     : Exit terminal.\n"
     );
 }
@@ -119,6 +132,142 @@ static void cmd_set_grey(const char* arg)
     Serial.print("Done.\n");
 }
 
+static const char* DITHER_NAMES[] = { "off", "bayer", "atkinson" };
+
+static void cmd_set_dither(const char* arg)
+{
+    int dither = -1;
+    for (int i = 0; i < sizeof(DITHER_NAMES) / sizeof(DITHER_NAMES[0]); i++) {
+        if (strcasecmp(arg, DITHER_NAMES[i]) == 0)
+            dither = i;
+    }
+
+    if (dither < 0) {
+        Serial.print("Invalid value. Must be [off|bayer|atkinson].\n");
+        return;
+    }
+
+    if (user_config_set_dither(dither))
+        return;
+
+    Serial.print("Done.\n");
+
+    if (user_config_get().grey_enabled && dither != COMPOSITE_DITHER_NONE)
+        Serial.print(
+            "NOTE: Dithering only applies to the 2-color display. "
+            "To disable grey, enter 'set grey off'.\n"
+        );
+}
+
+static void cmd_set_waveform(const char* arg)
+{
+    int waveform = -1;
+    for (int i = 0; i < WAVEFORM_COUNT; i++) {
+        if (strcasecmp(arg, lut_name((Waveform) i)) == 0)
+            waveform = i;
+    }
+
+    if (waveform < 0) {
+        Serial.print("Invalid value. Must be [standard|short|grey2|custom].\n");
+        return;
+    }
+
+    // validated now rather than found out at the next refresh
+    Lut lut;
+    if (lut_get((Waveform) waveform, &lut))
+        return;
+
+    if (user_config_set_waveform(waveform))
+        return;
+
+    Serial.printf("Done (%d frames).\n", lut_frames(lut.data));
+
+    if (!user_config_get().grey_enabled)
+        Serial.print(
+            "NOTE: The waveform only applies to the 4-color display. "
+            "To enable grey, enter 'set grey on'.\n"
+        );
+}
+
+static void cmd_load_waveform(const char* arg)
+{
+    static constexpr int TIMEOUT_MS = 10 * 1000;
+
+    // the upload in flight may be streaming the custom table
+    display_wait();
+
+    // whatever followed the command's return
+    while (Serial.available() > 0)
+        Serial.read();
+
+    Serial.printf("Send the %d byte waveform file.\n", LUT_FILE_BYTES);
+
+    uint8_t file[LUT_FILE_BYTES];
+    Serial.setTimeout(TIMEOUT_MS);
+    const int n_bytes = Serial.readBytes(file, sizeof(file));
+    if (n_bytes < (int) sizeof(file)) {
+        Serial.printf("Timed out after %d bytes.\n", n_bytes);
+        return;
+    }
+
+    if (lut_store(file, n_bytes))
+        return;
+
+    Serial.print("Done. To use it, enter 'set waveform custom'.\n");
+}
+
+static void cmd_set_spi(const char* arg)
+{
+    static constexpr int MAX_MHZ = 40;
+
+    const int mhz = atoi(arg);
+    if (mhz < 1 || mhz > MAX_MHZ) {
+        Serial.printf("Invalid value. Must be [1-%d].\n", MAX_MHZ);
+        return;
+    }
+
+    if (user_config_set_spi_mhz(mhz))
+        return;
+
+    const uint32_t hz = display_spi_init(mhz * 1000000);
+    if (hz != (uint32_t) mhz * 1000000)
+        Serial.printf("NOTE: Self-test failed, falling back to %u kHz.\n", (unsigned) (hz / 1000));
+
+    Serial.print("Done.\n");
+}
+
+static void cmd_set_partials(const char* arg)
+{
+    static constexpr int MAX_PARTIALS = 255;
+
+    const int limit = atoi(arg);
+    if (!isdigit(arg[0]) || limit > MAX_PARTIALS) {
+        Serial.printf("Invalid value. Must be [0-%d].\n", MAX_PARTIALS);
+        return;
+    }
+
+    if (user_config_set_partial_limit(limit))
+        return;
+
+    Serial.print("Done.\n");
+}
+
+static void cmd_set_full_refresh(const char* arg)
+{
+    static constexpr int MAX_MINUTES = 24 * 60;
+
+    const int minutes = atoi(arg);
+    if (!isdigit(arg[0]) || minutes > MAX_MINUTES) {
+        Serial.printf("Invalid value. Must be [0-%d].\n", MAX_MINUTES);
+        return;
+    }
+
+    if (user_config_set_full_refresh_min(minutes))
+        return;
+
+    Serial.print("Done.\n");
+}
+
 static void cmd_network(const char* arg)
 {
     const UserConfig& user = user_config_get();
@@ -183,6 +332,17 @@ static void cmd_status(const char* arg)
         
     Serial.printf("    Display         : %s\n",
         user.grey_enabled ? "4-color" : "2-color" );
+    Serial.printf("    Dithering       : %s\n",
+        (user.dither >= 0 && user.dither < sizeof(DITHER_NAMES) / sizeof(DITHER_NAMES[0])) ?
+            DITHER_NAMES[user.dither] : "(invalid)");
+    Serial.printf("    Waveform        : %s\n", lut_name((Waveform) user.waveform));
+    Serial.printf("    SPI Clock       : %d MHz (%u kHz in use)\n",
+        user.spi_mhz, (unsigned) (EpdIf::GetSpiClock() / 1000));
+    Serial.printf("    Partials        : %d between whole refreshes\n", user.partial_limit);
+    if (user.full_refresh_min > 0)
+        Serial.printf("    Full Refresh    : Every %d min and daily\n", user.full_refresh_min);
+    else
+        Serial.print("    Full Refresh    : Daily\n");
 }
 
 static void cmd_sync(const char* arg)
@@ -212,6 +372,236 @@ static void cmd_list_timezones(const char* arg)
         Serial.printf("%-30s  %s\n",posix_tz_db[i].key, posix_tz_db[i].value);
 }
 
+// the original composite.c loops, kept as the reference the kernels must match.
+// they only OR set-bit ink into byte aligned windows, i.e. COMPOSITE_INK_ONES
+// and COMPOSITE_OP_OR.
+static void bench_original_1bpp(uint8_t* out_1bpp, int x, int y, int w, int h,
+        int stride, const uint8_t* in_8bpp)
+{
+    const uint8_t* in = in_8bpp;
+
+    for (int i = 0; i < h; i++) {
+        uint8_t* out = out_1bpp + (y + i) * (stride / 8) + x / 8;
+
+        for (int j = 0; j < w; j += 8) {
+            for (int bit = 0; bit < 8; bit++)
+                *out |= (composite_to_1bpp(*in++)) >> bit;
+            out++;
+        }
+    }
+}
+
+static void bench_original_2bpp(uint8_t* out_2bpp, int x, int y, int w, int h,
+        int stride, const uint8_t* in_8bpp)
+{
+    const uint8_t* in = in_8bpp;
+
+    for (int i = 0; i < h; i++) {
+        uint8_t* out = out_2bpp + (y + i) * (stride / 4) + x / 4;
+
+        for (int j = 0; j < w; j += 4) {
+            for (int bit = 0; bit < 8; bit += 2)
+                *out |= composite_to_2bpp(*in++) >> bit;
+            out++;
+        }
+    }
+}
+
+static void bench_original_level(uint8_t* out_2bpp, int x, int y, int w, int h,
+        int stride, const uint8_t* in_8bpp)
+{
+    const uint8_t* in = in_8bpp;
+    const uint8_t level = 0x80;
+
+    for (int i = 0; i < h; i++) {
+        uint8_t* out = out_2bpp + (y + i) * (stride / 4) + x / 4;
+
+        for (int j = 0; j < w; j += 4) {
+            for (int bit = 0; bit < 8; bit += 2) {
+                const uint8_t pixel = *in++;
+                *out |= composite_to_2bpp((pixel < level) ? pixel : level) >> bit;
+            }
+            out++;
+        }
+    }
+}
+
+// level variants clamp to the dark grey draw() uses
+static void bench_level_scalar(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in, int op)
+{
+    composite_8bpp_to_2bpp_level_scalar(fb, x, y, w, h, in, 0x80, op);
+}
+
+static void bench_level_word(const struct composite_fb* fb, int x, int y, int w, int h,
+        const uint8_t* in, int op)
+{
+    composite_8bpp_to_2bpp_level_word(fb, x, y, w, h, in, 0x80, op);
+}
+
+// the per-pixel decode of one plane Epd::Gray4ToPlanes() replaced, kept as the baseline
+static void bench_gray4_plane_decode(const uint8_t* in, int n, uint8_t* out, bool plane_26)
+{
+    for (int i = 0; i < n; i++) {
+        uint8_t bits = 0;
+        for (int j = 0; j < 2; j++) {
+            uint8_t pixels = in[2 * i + j];
+            for (int k = 0; k < 4; k++) {
+                const uint8_t pixel = pixels & 0xC0;
+                bits <<= 1;
+                if (pixel == 0xC0)
+                    bits |= 0x01;                   // white
+                else if (pixel == 0x00)
+                    bits |= 0x00;                   // black
+                else if (pixel == 0x80)
+                    bits |= plane_26 ? 0x00 : 0x01; // gray1
+                else
+                    bits |= plane_26 ? 0x01 : 0x00; // gray2
+                pixels <<= 2;
+            }
+        }
+        out[i] = bits;
+    }
+}
+
+static void cmd_bench(const char* arg)
+{
+    // a full frame worth of pixels
+    constexpr int w = 400;
+    constexpr int h = 300;
+    constexpr int runs = 10;
+
+    uint8_t* in = (uint8_t*) malloc(w * h);
+    uint8_t* out = (uint8_t*) malloc(w * h / 4);
+    uint8_t* ref = (uint8_t*) malloc(w * h / 4);
+    if (!in || !out || !ref) {
+        Serial.print("Error: Out of memory.\n");
+        free(in);
+        free(out);
+        free(ref);
+        return;
+    }
+
+    for (int i = 0; i < w * h; i++)
+        in[i] = (uint8_t) (i * 37 + (i >> 7));
+
+    typedef void (*Kernel)(const struct composite_fb*, int, int, int, int, const uint8_t*, int);
+    typedef void (*Original)(uint8_t*, int, int, int, int, int, const uint8_t*);
+
+    const struct { const char* name; Original original; Kernel scalar; Kernel word; int bpp; } kernels[] = {
+        { "8bpp -> 1bpp      ", bench_original_1bpp,
+            composite_8bpp_to_1bpp_scalar, composite_8bpp_to_1bpp_word, 1 },
+        { "8bpp -> 2bpp      ", bench_original_2bpp,
+            composite_8bpp_to_2bpp_scalar, composite_8bpp_to_2bpp_word, 2 },
+        { "8bpp -> 2bpp level", bench_original_level, bench_level_scalar, bench_level_word, 2 },
+    };
+
+    Serial.print("Kernel               Original    Scalar      Word    (pixels / us)\n\n");
+    for (int k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        const int bytes = w * h * kernels[k].bpp / 8;
+
+        // original first into ref, then each kernel into out and compared against it
+        float rates[3];
+        bool same = true;
+        for (int v = 0; v < 3; v++) {
+            const struct composite_fb fb = { v ? out : ref, w, h, kernels[k].bpp, COMPOSITE_INK_ONES };
+
+            // compositing only adds ink, so repeated runs leave the same result
+            composite_fill_blank(&fb);
+
+            const uint32_t start = micros();
+            for (int r = 0; r < runs; r++) {
+                if (v == 0)
+                    kernels[k].original(ref, 0, 0, w, h, w, in);
+                else
+                    (v == 1 ? kernels[k].scalar : kernels[k].word)(&fb, 0, 0, w, h, in, COMPOSITE_OP_OR);
+            }
+            rates[v] = (float) w * h * runs / (float) (micros() - start);
+
+            // and a byte aligned window on top, the only placement the original handles
+            if (v == 0)
+                kernels[k].original(ref, 48, 17, 96, 61, w, in);
+            else
+                (v == 1 ? kernels[k].scalar : kernels[k].word)(&fb, 48, 17, 96, 61, in, COMPOSITE_OP_OR);
+
+            if (v)
+                same = same && memcmp(out, ref, bytes) == 0;
+        }
+
+        // every polarity / op / dither against the reference, unaligned and clipped
+        const int n_dithers = (kernels[k].bpp == 1) ? COMPOSITE_DITHER_ATKINSON + 1 : 1;
+        for (int polarity = COMPOSITE_INK_ONES; polarity <= COMPOSITE_INK_ZEROS; polarity++) {
+            for (int op = COMPOSITE_OP_OR; op <= COMPOSITE_OP_REPLACE; op++) {
+                for (int dither = 0; dither < n_dithers; dither++) {
+                    for (int v = 0; v < 2; v++) {
+                        const Kernel kernel = v ? kernels[k].word : kernels[k].scalar;
+                        const struct composite_fb fb = { v ? out : ref, w, h, kernels[k].bpp,
+                            polarity, dither };
+
+                        memset(fb.buf, 0x5A, bytes);
+                        kernel(&fb, w - 53, -3, 93, 61, in, op);
+                    }
+                    same = same && memcmp(out, ref, bytes) == 0;
+                }
+            }
+        }
+
+        Serial.printf("    %s  %6.1f    %6.1f    %6.1f    %s\n", kernels[k].name,
+            rates[0], rates[1], rates[2], same ? "" : "MISMATCH");
+    }
+
+    {
+        // 4-gray RAM planes from a 2bpp frame, conversion only
+        const int n = w * h / 8;
+        uint8_t* planes = out;
+        uint8_t* ref_planes = ref;
+
+        uint32_t start = micros();
+        for (int r = 0; r < runs; r++) {
+            bench_gray4_plane_decode(in, n, ref_planes, false);
+            bench_gray4_plane_decode(in, n, ref_planes + n, true);
+        }
+        const uint32_t decode_us = (micros() - start) / runs;
+
+        start = micros();
+        for (int r = 0; r < runs; r++)
+            Epd::Gray4ToPlanes(in, n, planes, planes + n);
+        const uint32_t lut_us = (micros() - start) / runs;
+
+        const bool same = memcmp(planes, ref_planes, 2 * n) == 0;
+        Serial.printf("\n4-gray planes          %6u us  %6u us  (per frame)  %s\n",
+            (unsigned) decode_us, (unsigned) lut_us, same ? "" : "MISMATCH");
+    }
+
+    {
+        // one black / white RAM plane to the panel, per byte against bulk; nothing is refreshed
+        const int n = w * h / 8;
+        display_wait();
+        Epd epd;
+        epd.Init();
+        Epd::PlaneChanged(0x24);
+
+        uint32_t start = micros();
+        epd.SendCommand(0x24);
+        for (int i = 0; i < n; i++)
+            epd.SendData(out[i]);
+        const uint32_t byte_us = micros() - start;
+
+        start = micros();
+        epd.SendCommand(0x24);
+        epd.SendDataBuffer(out, n);
+        const uint32_t bulk_us = micros() - start;
+
+        epd.Sleep();
+        Serial.printf("SPI plane upload       %6u us  %6u us  (per byte / bulk)\n",
+            (unsigned) byte_us, (unsigned) bulk_us);
+    }
+
+    free(in);
+    free(out);
+    free(ref);
+}
+
 const struct { const char* cmd; void (*fn)(const char* arg); } BOOK[] = {
     { "help",               cmd_help },
     { "set ssid",           cmd_set_ssid },
@@ -219,12 +609,19 @@ const struct { const char* cmd; void (*fn)(const char* arg); } BOOK[] = {
     { "set timezone",       cmd_set_timezone },
     { "set geolocation",    cmd_set_geolocation },
     { "set grey",           cmd_set_grey },
+    { "set dither",         cmd_set_dither },
+    { "set waveform",       cmd_set_waveform },
+    { "load waveform",      cmd_load_waveform },
+    { "set spi",            cmd_set_spi },
+    { "set partials",       cmd_set_partials },
+    { "set fullrefresh",    cmd_set_full_refresh },
     { "list timezones",     cmd_list_timezones },
     { "network",            cmd_network },
     { "reset",              cmd_reset },
     { "status",             cmd_status },
     { "sync",               cmd_sync },
     { "time",               cmd_time },
+    { "bench",              cmd_bench },
 };
 
 static int term_read(char* buf, int buf_size)
@@ -2,31 +2,142 @@
 
 #include "ttf_render.h"
 
+#include "composite.h"
+
+#include <stddef.h>
+
+// stb_truetype allocates through the arena passed as stbtt_fontinfo.userdata
+static void* arena_alloc(size_t size, void* userdata);
+static void arena_free(void* ptr, void* userdata);
+
+#define STBTT_malloc(x, u)  arena_alloc(x, u)
+#define STBTT_free(x, u)    arena_free(x, u)
+
 #define STB_TRUETYPE_IMPLEMENTATION 
 #include "ext/stb_truetype.h" /* http://nothings.org/stb/stb_truetype.h */
 
 #include <assert.h>
+#include <limits.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 
 
-int TTF_init(struct TTF_t* state, const uint8_t* ttf)
+static void* arena_alloc(size_t size, void* userdata)
 {
-    assert(state);
+    struct TTF_arena* arena = (struct TTF_arena*) userdata;
+
+    if (arena) {
+        const int offset = (arena->used + 7) & ~7;
+        if (offset + (int) size <= arena->size) {
+            arena->used = offset + (int) size;
+            if (arena->used > arena->high_water)
+                arena->high_water = arena->used;
+            return &arena->buf[offset];
+        }
+
+        arena->overflows++;
+    }
+
+    return malloc(size);
+}
+
+static void arena_free(void* ptr, void* userdata)
+{
+    struct TTF_arena* arena = (struct TTF_arena*) userdata;
+
+    // arena memory is released all at once, see render_glyph
+    if (arena && (uint8_t*) ptr >= arena->buf && (uint8_t*) ptr < arena->buf + arena->size)
+        return;
+
+    free(ptr);
+}
+
+static uint32_t font_hash(const uint8_t* ttf)
+{
+    // offset table and table records, FNV-1a
+    const int n_tables = (ttf[4] << 8) | ttf[5];
+    const int size = 12 + 16 * n_tables;
+
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        hash ^= ttf[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
 
-    stbtt_fontinfo* stbtt = &state->stbtt;
+static int font_init(struct TTF_font* font, const uint8_t* ttf)
+{
+    stbtt_fontinfo* stbtt = &font->stbtt;
 
     // init stbtt font
-    if (!stbtt_InitFont(stbtt, ttf, 0))
+    if (!stbtt_InitFont(stbtt, ttf, 0)) {
+        stbtt->data = NULL;
         return -1;
+    }
 
     int descent, line_gap;
-    stbtt_GetFontVMetrics(stbtt, &state->ascent, &descent, &line_gap);
+    stbtt_GetFontVMetrics(stbtt, &font->ascent, &descent, &line_gap);
 
+    // flat cmap for printable ascii
+    for (int i = 0; i < TTF_ASCII_COUNT; i++)
+        font->ascii_glyphs[i] = (uint16_t) stbtt_FindGlyphIndex(stbtt, TTF_ASCII_FIRST + i);
+
+    font->n_scales = 0;
+    font->hash = font_hash(ttf);
     return 0;
 }
 
+int TTF_init(struct TTF_t* state, const uint8_t* ttf)
+{
+    assert(state);
+
+    state->font = &state->font_storage;
+    state->ascii_kern = NULL;
+    state->cache = NULL;
+    state->arena = NULL;
+
+    return font_init(state->font, ttf);
+}
+
+int TTF_init_font(struct TTF_t* state, const uint8_t* ttf, struct TTF_font* font)
+{
+    assert(state);
+    assert(font);
+
+    state->font = font;
+    state->ascii_kern = NULL;
+    state->cache = NULL;
+    state->arena = NULL;
+
+    // parsed on a previous wake, as long as it's the same blob
+    if (font->stbtt.data == ttf && font->hash == font_hash(ttf))
+        return 0;
+
+    return font_init(font, ttf);
+}
+
+static void rect_clear(struct TTF_rect* rect)
+{
+    rect->x0 = rect->y0 = INT_MAX;
+    rect->x1 = rect->y1 = INT_MIN;
+}
+
+static void rect_grow(struct TTF_rect* rect, int x0, int y0, int x1, int y1)
+{
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    if (x0 < rect->x0) rect->x0 = x0;
+    if (y0 < rect->y0) rect->y0 = y0;
+    if (x1 > rect->x1) rect->x1 = x1;
+    if (y1 > rect->y1) rect->y1 = y1;
+}
+
 void TTF_set_canvas(struct TTF_t* state, uint8_t* buf, int w, int h)
 {
     assert(state);
@@ -37,6 +148,166 @@ void TTF_set_canvas(struct TTF_t* state, uint8_t* buf, int w, int h)
     state->canvas = buf;
     state->canvas_w = w;
     state->canvas_h = h;
+    state->canvas_bpp = 8;
+    state->canvas_level = 0xFF;
+    state->canvas_polarity = COMPOSITE_INK_ONES;
+    state->canvas_dither = COMPOSITE_DITHER_NONE;
+    rect_clear(&state->dirty);
+}
+
+void TTF_set_canvas_packed(struct TTF_t* state, const struct composite_fb* fb, uint8_t level)
+{
+    assert(state);
+    assert(fb);
+    assert(fb->buf);
+    assert(fb->w);
+    assert(fb->h);
+    assert(fb->bpp == 1 || fb->bpp == 2);
+    assert(fb->w % (8 / fb->bpp) == 0);
+
+    state->canvas = fb->buf;
+    state->canvas_w = fb->w;
+    state->canvas_h = fb->h;
+    state->canvas_bpp = fb->bpp;
+    state->canvas_level = level;
+    state->canvas_polarity = fb->polarity;
+    state->canvas_dither = fb->dither;
+    rect_clear(&state->dirty);
+}
+
+void TTF_set_kerning(struct TTF_t* state, const int16_t* ascii_kern)
+{
+    assert(state);
+
+    state->ascii_kern = ascii_kern;
+}
+
+void TTF_set_cache(struct TTF_t* state, struct TTF_cache* cache)
+{
+    assert(state);
+
+    state->cache = cache;
+}
+
+void TTF_set_arena(struct TTF_t* state, struct TTF_arena* arena)
+{
+    assert(state);
+
+    state->arena = arena;
+}
+
+void TTF_arena_init(struct TTF_arena* arena, uint8_t* buf, int size)
+{
+    assert(arena);
+    assert(buf);
+
+    arena->buf = buf;
+    arena->size = size;
+    arena->used = 0;
+    arena->high_water = 0;
+    arena->overflows = 0;
+}
+
+void TTF_cache_begin(struct TTF_cache* cache)
+{
+    assert(cache);
+
+    cache->epoch++;
+}
+
+static struct TTF_cache_entry* cache_find(struct TTF_cache* cache, uint32_t font,
+        float line_height, int glyph, int phase)
+{
+    for (int i = 0; i < cache->n_entries; i++) {
+        struct TTF_cache_entry* entry = &cache->entries[i];
+        if (entry->font == font && entry->line_height == line_height
+                && entry->glyph == glyph && entry->phase == phase)
+            return entry;
+    }
+
+    return NULL;
+}
+
+static void cache_remove(struct TTF_cache* cache, int idx)
+{
+    const struct TTF_cache_entry removed = cache->entries[idx];
+
+    // compact pool
+    const int tail = removed.offset + removed.size;
+    memmove(&cache->pool[removed.offset], &cache->pool[tail], cache->pool_used - tail);
+    cache->pool_used -= removed.size;
+
+    cache->entries[idx] = cache->entries[--cache->n_entries];
+
+    for (int i = 0; i < cache->n_entries; i++) {
+        if (cache->entries[i].offset > removed.offset)
+            cache->entries[i].offset -= removed.size;
+    }
+}
+
+static int cache_evict(struct TTF_cache* cache)
+{
+    // least recently used, never from the current epoch
+    int lru = -1;
+    for (int i = 0; i < cache->n_entries; i++) {
+        const struct TTF_cache_entry* entry = &cache->entries[i];
+        if (entry->epoch == cache->epoch)
+            continue;
+        if (lru < 0 || entry->epoch < cache->entries[lru].epoch)
+            lru = i;
+    }
+
+    if (lru < 0)
+        return -1;
+
+    cache_remove(cache, lru);
+    return 0;
+}
+
+static struct TTF_cache_entry* cache_insert(struct TTF_cache* cache, uint32_t font,
+        float line_height, int glyph, int phase, int y0, int w, int h)
+{
+    const int size = (w * h + 3) / 4;
+    if (size > TTF_CACHE_POOL_BYTES)
+        return NULL;
+
+    while (cache->n_entries == TTF_CACHE_ENTRIES || cache->pool_used + size > TTF_CACHE_POOL_BYTES) {
+        if (cache_evict(cache))
+            return NULL;
+    }
+
+    struct TTF_cache_entry* entry = &cache->entries[cache->n_entries++];
+    entry->font = font;
+    entry->line_height = line_height;
+    entry->glyph = (uint16_t) glyph;
+    entry->phase = (uint8_t) phase;
+    entry->y0 = (int16_t) y0;
+    entry->w = (uint16_t) w;
+    entry->h = (uint16_t) h;
+    entry->offset = (uint16_t) cache->pool_used;
+    entry->size = (uint16_t) size;
+    entry->epoch = cache->epoch;
+
+    cache->pool_used += size;
+    return entry;
+}
+
+static void pack_2bpp(uint8_t* out, const uint8_t* in, int n)
+{
+    memset(out, 0, (n + 3) / 4);
+
+    for (int i = 0; i < n; i++)
+        out[i / 4] |= (in[i] >> 6) << (6 - 2 * (i % 4));
+}
+
+static int imin(int a, int b)
+{
+    return (a < b) ? a : b;
+}
+
+static int imax(int a, int b)
+{
+    return (a > b) ? a : b;
 }
 
 static int ifloor(float x)
@@ -54,107 +325,404 @@ static float ffrac(float x)
     return x - floor(x);
 }
 
+// 2bpp pixel codes (see composite_to_2bpp) have their bits swapped
+// relative to coverage, swapping back gives a level that sorts
+static uint8_t level_2bpp(uint8_t code)
+{
+    return ((code & 0x01) << 1) | (code >> 1);
+}
+
+// accumulates 8bpp coverage into a packed canvas, with the same
+// threshold / level semantics as the compositors
+static void plot_packed(struct TTF_t* state, int x, int y, uint8_t coverage)
+{
+    // flips stored bits to ink-is-set and back
+    const uint8_t flip = (state->canvas_polarity == COMPOSITE_INK_ZEROS) ? 0xFF : 0x00;
+
+    // cached glyphs only keep 2 bits of coverage, quantize fresh ones the same
+    // way so a glyph dithers alike whether or not it came from the cache
+    coverage = (coverage >> 6) * 0x55;
+
+    if (state->canvas_bpp == 1) {
+        // glyphs land one at a time, which error diffusion can't follow. ordered
+        // dithering only looks at position, so it accumulates like thresholding.
+        const uint8_t pixel = (state->canvas_dither == COMPOSITE_DITHER_NONE) ?
+            composite_to_1bpp(coverage) : composite_to_1bpp_bayer(coverage, x, y);
+
+        uint8_t* out = &state->canvas[y * (state->canvas_w / 8) + x / 8];
+        *out = ((*out ^ flip) | (pixel >> (x % 8))) ^ flip;
+    } else {
+        uint8_t* out = &state->canvas[y * (state->canvas_w / 4) + x / 4];
+        if (coverage > state->canvas_level)
+            coverage = state->canvas_level;
+
+        // keep the darker of the two
+        const int shift = 6 - 2 * (x % 4);
+        const uint8_t code = composite_to_2bpp(coverage) >> 6;
+        const uint8_t prev = ((*out ^ flip) >> shift) & 0x03;
+        if (level_2bpp(code) > level_2bpp(prev))
+            *out = (*out & ~(0x03 << shift)) | ((code ^ flip) & 0x03) << shift;
+    }
+}
+
+static void plot(struct TTF_t* state, int x, int y, uint8_t coverage)
+{
+    if (state->canvas_bpp != 8) {
+        plot_packed(state, x, y, coverage);
+        return;
+    }
+
+    uint8_t* out = &state->canvas[y * state->canvas_w + x];
+    if (coverage > *out)
+        *out = coverage;
+}
+
+// glyphs are accumulated rather than copied, so overlapping neighbours
+// keep their edges and the canvas only needs clearing once per frame
+static void blit_8bpp(struct TTF_t* state, const uint8_t* bitmap, int x, int y, int w, int h)
+{
+    // clip to canvas
+    const int i0 = imax(0, -y);
+    const int i1 = imin(h, state->canvas_h - y);
+    const int j0 = imax(0, -x);
+    const int j1 = imin(w, state->canvas_w - x);
+
+    rect_grow(&state->dirty, x + j0, y + i0, x + j1, y + i1);
+
+    for (int i = i0; i < i1; i++) {
+        const uint8_t* in = &bitmap[i * w];
+
+        for (int j = j0; j < j1; j++) {
+            if (in[j])
+                plot(state, x + j, y + i, in[j]);
+        }
+    }
+}
+
+static void blit_2bpp(struct TTF_t* state, const uint8_t* bitmap, int x, int y, int w, int h)
+{
+    // clip to canvas
+    const int i0 = imax(0, -y);
+    const int i1 = imin(h, state->canvas_h - y);
+    const int j0 = imax(0, -x);
+    const int j1 = imin(w, state->canvas_w - x);
+
+    rect_grow(&state->dirty, x + j0, y + i0, x + j1, y + i1);
+
+    for (int i = i0; i < i1; i++) {
+        for (int j = j0; j < j1; j++) {
+            const int idx = i * w + j;
+            // spread levels over the full range, so solid ink stays solid when dithered
+            const uint8_t coverage = ((bitmap[idx / 4] >> (6 - 2 * (idx % 4))) & 0x03) * 0x55;
+
+            if (coverage)
+                plot(state, x + j, y + i, coverage);
+        }
+    }
+}
+
+static void render_glyph(struct TTF_t* state, int glyph, float scale, float line_height,
+        int x, int y, int phase, float shift_y)
+{
+    stbtt_fontinfo* stbtt = &state->font->stbtt;
+    struct TTF_cache* cache = state->cache;
+    const uint32_t font = (uint32_t) (uintptr_t) stbtt->data;
+    const float shift_x = (float) phase / TTF_SUBPIXEL_STEPS;
+
+    if (cache) {
+        struct TTF_cache_entry* entry = cache_find(cache, font, line_height, glyph, phase);
+        if (entry) {
+            cache->hits++;
+            entry->epoch = cache->epoch;
+            blit_2bpp(state, &cache->pool[entry->offset], x, y + entry->y0, entry->w, entry->h);
+            return;
+        }
+
+        cache->misses++;
+    }
+
+    // get bounding box coordinates, relative to current position
+    int glyph_x1, glyph_y1, glyph_x2, glyph_y2;
+    stbtt_GetGlyphBitmapBoxSubpixel(stbtt, glyph, scale, scale, shift_x,
+            shift_y, &glyph_x1, &glyph_y1, &glyph_x2, &glyph_y2);
+    const int glyph_w = glyph_x2 - glyph_x1;
+    const int glyph_h = glyph_y2 - glyph_y1;
+
+    // rasterization memory is transient, rewind the arena once the glyph is drawn
+    struct TTF_arena* arena = state->arena;
+    const int arena_mark = arena ? arena->used : 0;
+    stbtt->userdata = arena;
+
+    uint8_t* bitmap = (uint8_t*) STBTT_malloc(glyph_w * glyph_h + 1, arena);
+    if (!bitmap)
+        return;
+
+    stbtt_MakeGlyphBitmapSubpixel(stbtt, bitmap, glyph_w, glyph_h,
+            glyph_w, scale, scale, shift_x, shift_y, glyph);
+    blit_8bpp(state, bitmap, x, y + glyph_y1, glyph_w, glyph_h);
+
+    if (cache) {
+        struct TTF_cache_entry* entry = cache_insert(cache, font, line_height, glyph, phase,
+                glyph_y1, glyph_w, glyph_h);
+        if (entry)
+            pack_2bpp(&cache->pool[entry->offset], bitmap, glyph_w * glyph_h);
+    }
+
+    STBTT_free(bitmap, arena);
+
+    if (arena)
+        arena->used = arena_mark;
+}
+
+static float get_scale(struct TTF_t* state, float line_height)
+{
+    struct TTF_font* font = state->font;
+
+    for (int i = 0; i < font->n_scales; i++) {
+        if (font->scale_heights[i] == line_height)
+            return font->scales[i];
+    }
+
+    const float scale = stbtt_ScaleForPixelHeight(&font->stbtt, line_height);
+
+    if (font->n_scales < TTF_SCALE_SLOTS) {
+        font->scale_heights[font->n_scales] = line_height;
+        font->scales[font->n_scales] = scale;
+        font->n_scales++;
+    }
+
+    return scale;
+}
+
+static int is_ascii(int codepoint)
+{
+    return (codepoint >= TTF_ASCII_FIRST && codepoint < TTF_ASCII_FIRST + TTF_ASCII_COUNT);
+}
+
+static int find_glyph(struct TTF_t* state, int codepoint)
+{
+    if (is_ascii(codepoint))
+        return state->font->ascii_glyphs[codepoint - TTF_ASCII_FIRST];
+
+    return stbtt_FindGlyphIndex(&state->font->stbtt, codepoint);
+}
+
+static int get_kern(struct TTF_t* state, int codepoint, int next_codepoint, int glyph, int next_glyph)
+{
+    if (next_codepoint == '\0')
+        return 0;
+
+    if (state->ascii_kern && is_ascii(codepoint) && is_ascii(next_codepoint)) {
+        const int idx = (codepoint - TTF_ASCII_FIRST) * TTF_ASCII_COUNT + (next_codepoint - TTF_ASCII_FIRST);
+        return state->ascii_kern[idx];
+    }
+
+    return stbtt_GetGlyphKernAdvance(&state->font->stbtt, glyph, next_glyph);
+}
+
 static int draw_vline(struct TTF_t* state, int x)
 {
     for (int i = 0; i < state->canvas_h; i++)
         state->canvas[i * state->canvas_w + x] = 0x0F;
 }
 
-int TTF_render_width(struct TTF_t* state, const char* str, float line_height)
+int TTF_shape(struct TTF_t* state, struct TTF_run* run, const char* str, float line_height)
 {
     assert(state);
+    assert(run);
+
+    stbtt_fontinfo* stbtt = &state->font->stbtt;
 
-    stbtt_fontinfo* stbtt = &state->stbtt;
-    uint8_t* canvas = state->canvas;
-    const int canvas_w = state->canvas_w;
+    const float scale = get_scale(state, line_height);
+    const float ascent = (float) state->font->ascent * scale;
+    int glyph = find_glyph(state, (int) str[0]);
 
-    const float scale = stbtt_ScaleForPixelHeight(stbtt, line_height);
-    const float ascent = (float) state->ascent * scale;
-    int glyph = stbtt_FindGlyphIndex(stbtt, (int) str[0]);
+    float pos_x = 0.f;
+
+    run->font = (uint32_t) (uintptr_t) stbtt->data;
+    run->line_height = line_height;
+    run->scale = scale;
+    run->ascent = ascent;
+    run->n_glyphs = 0;
+
+    for (int i = 0; str[i] != '\0'; i++) {
+        if (run->n_glyphs == TTF_RUN_MAX_GLYPHS)
+            return -1;
 
-    float size = 0.f;
+        // get horizontal metrics
+        int advance;
+        int left_side_bearing;
+        stbtt_GetGlyphHMetrics(stbtt, glyph, &advance, &left_side_bearing);
 
-    for (int i = 0; str[i] != '\0' ; i++) {
-        int advance, _;
-        stbtt_GetGlyphHMetrics(stbtt, glyph, &advance, &_);
+        struct TTF_run_glyph* run_glyph = &run->glyphs[run->n_glyphs++];
+        run_glyph->glyph = (uint16_t) glyph;
+        run_glyph->x = pos_x + left_side_bearing * scale;
 
         // get next glyph
         const int next_codepoint = (int) str[i + 1];
-        const int next_glyph = stbtt_FindGlyphIndex(stbtt, next_codepoint);
-        const int kern = stbtt_GetGlyphKernAdvance(stbtt, glyph, next_glyph);
-        size += (advance + kern) * scale;
+        const int next_glyph = find_glyph(state, next_codepoint);
+
+        // get kerning
+        const int kern = get_kern(state, (int) str[i], next_codepoint, glyph, next_glyph);
+
+        // advance x coordinate
+        pos_x += (advance + kern) * scale;
+
         glyph = next_glyph;
     }
 
-    return iceil(size);
+    run->advance = pos_x;
+    return iceil(pos_x);
 }
 
-int TTF_render(struct TTF_t* state, const char* str, float x, float y, float line_height)
+static float align_x(const struct TTF_run* run, float x, int align)
 {
-    assert(state);
+    const int width = iceil(run->advance);
 
-    stbtt_fontinfo* stbtt = &state->stbtt;
-    uint8_t* canvas = state->canvas;
-    const int canvas_w = state->canvas_w;
+    if (align & TTF_ALIGN_CENTER)
+        return x - width / 2.f;
+    if (align & TTF_ALIGN_RIGHT)
+        return x - width;
 
-    const float scale = stbtt_ScaleForPixelHeight(stbtt, line_height);
-    const float ascent = (float) state->ascent * scale;
-    int glyph = stbtt_FindGlyphIndex(stbtt, (int) str[0]);
+    return x;
+}
+
+int TTF_render_run(struct TTF_t* state, const struct TTF_run* run, float x, float y, int align)
+{
+    assert(state);
+    assert(run);
 
-    float pos_x = x;
-    float size = 0.f;
+    const int width = iceil(run->advance);
+    x = align_x(run, x, align);
 
-    const float pos_y = y + ascent;
+    const float pos_y = (align & TTF_ALIGN_BASELINE) ? y : y + run->ascent;
     const int pos_y_floor = ifloor(pos_y);
     const int pos_y_frac = ffrac(pos_y);
 
-    for (int i = 0; str[i] != '\0'; i++) {
+    for (int i = 0; i < run->n_glyphs; i++) {
+        const struct TTF_run_glyph* run_glyph = &run->glyphs[i];
 
-        // get horizontal metrics
-        int advance;
-        int left_side_bearing;
-        stbtt_GetGlyphHMetrics(stbtt, glyph, &advance, &left_side_bearing);
+        // calc x draw position, snapped to a subpixel phase
+        const float draw_x = x + run_glyph->x;
+        int draw_x_floor = ifloor(draw_x);
+        int phase = (int) (ffrac(draw_x) * TTF_SUBPIXEL_STEPS + 0.5f);
+        if (phase == TTF_SUBPIXEL_STEPS) {
+            draw_x_floor++;
+            phase = 0;
+        }
 
-        // calc x draw position
-        const float draw_x = pos_x + left_side_bearing * scale;
-        const int draw_x_floor = ifloor(draw_x);
-        const float draw_x_frac = ffrac(draw_x);
-
-        // get bounding box coordinates, relative to current position 
-        int glyph_x1, glyph_y1, glyph_x2, glyph_y2;
-        stbtt_GetGlyphBitmapBoxSubpixel(stbtt, glyph, scale, scale, draw_x_frac,
-                pos_y_frac, &glyph_x1, &glyph_y1, &glyph_x2, &glyph_y2);
-        const int glyph_w = glyph_x2 - glyph_x1;
-        const int glyph_h = glyph_y2 - glyph_y1;
-
-        const int draw_y_floor = pos_y_floor + glyph_y1;
-        const float draw_y_frac = pos_y_frac;
-        
         // render glyph
-        const int offset = draw_y_floor * canvas_w + draw_x_floor;
-        stbtt_MakeGlyphBitmapSubpixel(stbtt, &canvas[offset], glyph_w, glyph_h,
-                canvas_w, scale, scale, draw_x_frac, draw_y_frac, glyph);
+        render_glyph(state, run_glyph->glyph, run->scale, run->line_height, draw_x_floor,
+                pos_y_floor, phase, pos_y_frac);
+    }
 
-        // get next glyph
-        const int next_codepoint = (int) str[i + 1];
-        const int next_glyph = stbtt_FindGlyphIndex(stbtt, next_codepoint);
+    return width;
+}
 
-        // get kerning
-        const int kern = stbtt_GetGlyphKernAdvance(stbtt, glyph, next_glyph);
+int TTF_render_width(struct TTF_t* state, const char* str, float line_height)
+{
+    struct TTF_run run;
+    return TTF_shape(state, &run, str, line_height);
+}
+
+int TTF_render(struct TTF_t* state, const char* str, float x, float y, float line_height)
+{
+    struct TTF_run run;
+    if (TTF_shape(state, &run, str, line_height) < 0)
+        return -1;
+
+    return TTF_render_run(state, &run, x, y, TTF_ALIGN_LEFT);
+}
+
+int TTF_render_centered(struct TTF_t* state, const char* str, float x, float y, float line_height)
+{
+    struct TTF_run run;
+    if (TTF_shape(state, &run, str, line_height) < 0)
+        return -1;
+
+    return TTF_render_run(state, &run, x, y, TTF_ALIGN_CENTER);
+}
+
+static int atlas_find(const struct TTF_atlas* atlas, char c)
+{
+    for (int i = 0; i < atlas->n_chars; i++) {
+        if (atlas->chars[i] == c)
+            return i;
+    }
+
+    return -1;
+}
+
+static int atlas_advance(const struct TTF_atlas* atlas, int idx, int next_idx)
+{
+    int advance = atlas->glyphs[idx].advance;
+
+    if (next_idx >= 0)
+        advance += atlas->kern[idx * atlas->n_chars + next_idx];
+
+    return advance;
+}
+
+int TTF_atlas_render_width(const struct TTF_atlas* atlas, const char* str)
+{
+    assert(atlas);
+
+    int idx = atlas_find(atlas, str[0]);
+    int size = 0;
+
+    for (int i = 0; str[i] != '\0'; i++) {
+        if (idx < 0)
+            return -1;
+
+        const int next_idx = atlas_find(atlas, str[i + 1]);
+        size += atlas_advance(atlas, idx, next_idx);
+        idx = next_idx;
+    }
+
+    return iceil(size / 64.f);
+}
+
+int TTF_atlas_render(struct TTF_t* state, const struct TTF_atlas* atlas, const char* str, float x, float y)
+{
+    assert(state);
+    assert(atlas);
+
+    // don't draw anything unless every char is available
+    for (int i = 0; str[i] != '\0'; i++) {
+        if (atlas_find(atlas, str[i]) < 0)
+            return -1;
+    }
+
+    int idx = atlas_find(atlas, str[0]);
+    int pos_x = ifloor(x * 64.f + 0.5f);
+    int size = 0;
+
+    const int pos_y = ifloor(y + atlas->ascent / 64.f);
+
+    for (int i = 0; str[i] != '\0'; i++) {
+        const struct TTF_atlas_glyph* glyph = &atlas->glyphs[idx];
+
+        // glyphs are rasterized at phase 0, round to the nearest pixel
+        const int draw_x = ifloor((pos_x + glyph->left_side_bearing) / 64.f + 0.5f);
+        blit_2bpp(state, &atlas->bitmap[glyph->offset], draw_x, pos_y + glyph->y0, glyph->w, glyph->h);
 
         // advance x coordinate
-        const float advance_x = (advance + kern) * scale;
+        const int next_idx = atlas_find(atlas, str[i + 1]);
+        const int advance_x = atlas_advance(atlas, idx, next_idx);
         pos_x += advance_x;
         size += advance_x;
 
-        glyph = next_glyph;
+        idx = next_idx;
     }
 
-    return iceil(size);
+    return iceil(size / 64.f);
 }
 
-int TTF_render_centered(struct TTF_t* state, const char* str, float x, float y, float line_height)
+int TTF_atlas_render_centered(struct TTF_t* state, const struct TTF_atlas* atlas, const char* str, float x, float y)
 {
-    const int width = TTF_render_width(state, str, line_height);
-    TTF_render(state, str, x - width / 2.f, y, line_height);
+    const int width = TTF_atlas_render_width(atlas, str);
+    if (width < 0)
+        return -1;
+
+    return TTF_atlas_render(state, atlas, str, x - width / 2.f, y);
 }
\ No newline at end of file
@@ -13,23 +13,178 @@ extern "C" {
 
 
 
+#define TTF_SUBPIXEL_STEPS      4       // horizontal glyph phases per pixel
+#define TTF_CACHE_ENTRIES       32
+#define TTF_CACHE_POOL_BYTES    4096
+
+// glyph coverage is cached at 2bpp (4 px / byte), which is all the
+// compositors ever read from the canvas
+struct TTF_cache_entry
+{
+    uint32_t        font;
+    float           line_height;
+    uint16_t        glyph;
+    uint8_t         phase;
+    int16_t         y0;
+    uint16_t        w;
+    uint16_t        h;
+    uint16_t        offset;
+    uint16_t        size;
+    uint32_t        epoch;
+};
+
+// plain data, so it can be placed in RTC memory and survive deep sleep
+struct TTF_cache
+{
+    uint32_t                epoch;
+    uint32_t                hits;
+    uint32_t                misses;
+    int                     n_entries;
+    int                     pool_used;
+    struct TTF_cache_entry  entries[TTF_CACHE_ENTRIES];
+    uint8_t                 pool[TTF_CACHE_POOL_BYTES];
+};
+
+// pre-rasterized glyphs, generated by scripts/atlas_embed.sh
+// metrics are in 1/64 px, coverage is 2bpp rasterized at subpixel phase 0
+struct TTF_atlas_glyph
+{
+    int16_t         left_side_bearing;
+    int16_t         advance;
+    int16_t         y0;
+    uint16_t        w;
+    uint16_t        h;
+    uint32_t        offset;
+};
+
+struct TTF_atlas
+{
+    const char*                     chars;
+    int                             n_chars;
+    int                             ascent;
+    const struct TTF_atlas_glyph*   glyphs;
+    const int16_t*                  kern;
+    const uint8_t*                  bitmap;
+};
+
+#define TTF_RUN_MAX_GLYPHS      32
+
+// half open, [x0, x1) x [y0, y1)
+struct TTF_rect
+{
+    int             x0;
+    int             y0;
+    int             x1;
+    int             y1;
+};
+
+#define TTF_ASCII_FIRST         0x20    // printable ascii, what ttf_embed.sh keeps
+#define TTF_ASCII_COUNT         95
+
+enum TTF_align
+{
+    TTF_ALIGN_LEFT      = 0,
+    TTF_ALIGN_CENTER    = 1 << 0,
+    TTF_ALIGN_RIGHT     = 1 << 1,
+    TTF_ALIGN_BASELINE  = 1 << 2,   // y is the baseline rather than the top of the line
+};
+
+struct TTF_run_glyph
+{
+    uint16_t        glyph;
+    float           x;      // pen + left side bearing, px from run origin
+};
+
+// shaped string, plain data so it can be kept and re-rendered across frames
+struct TTF_run
+{
+    uint32_t                font;
+    float                   line_height;
+    float                   scale;
+    float                   ascent;     // px
+    float                   advance;    // px
+    int                     n_glyphs;
+    struct TTF_run_glyph    glyphs[TTF_RUN_MAX_GLYPHS];
+};
+
+#define TTF_SCALE_SLOTS         4
+
+// parsed font, plain data pointing into the font blob, so it can be kept
+// in RTC memory and reused on later wakes, see TTF_init_font
+struct TTF_font
+{
+    uint32_t            hash;
+    stbtt_fontinfo      stbtt;
+    int                 ascent;
+    uint16_t            ascii_glyphs[TTF_ASCII_COUNT];
+    int                 n_scales;
+    float               scale_heights[TTF_SCALE_SLOTS];
+    float               scales[TTF_SCALE_SLOTS];
+};
+
+// bump allocator for glyph rasterization, falls back to the heap when full
+struct TTF_arena
+{
+    uint8_t*        buf;
+    int             size;
+    int             used;
+    int             high_water;
+    int             overflows;
+};
+
 struct TTF_t
 {
-    stbtt_fontinfo  stbtt;
-    uint8_t*        canvas;
-    int             canvas_w;
-    int             canvas_h;
-    int             ascent;
+    struct TTF_font*    font;
+    struct TTF_font     font_storage;
+    uint8_t*            canvas;
+    int                 canvas_w;
+    int                 canvas_h;
+    int                 canvas_bpp;
+    uint8_t             canvas_level;   // max coverage, packed canvases only
+    int                 canvas_polarity;
+    int                 canvas_dither;
+    struct TTF_rect     dirty;          // pixels drawn since the canvas was set
+    const int16_t*      ascii_kern;
+    struct TTF_cache*   cache;
+    struct TTF_arena*   arena;
 };
 
+struct composite_fb;
+
 int TTF_init(struct TTF_t* state, const uint8_t* ttf);
 
+// reuses font if it was parsed from the same blob, otherwise (re)parses into it
+int TTF_init_font(struct TTF_t* state, const uint8_t* ttf, struct TTF_font* font);
+
 void TTF_set_canvas(struct TTF_t* state, uint8_t* buf, int w, int h);
 
+// render straight into a 1bpp / 2bpp framebuffer, w is the row stride in pixels
+void TTF_set_canvas_packed(struct TTF_t* state, const struct composite_fb* fb, uint8_t level);
+void TTF_set_cache(struct TTF_t* state, struct TTF_cache* cache);
+
+// [left - TTF_ASCII_FIRST][right - TTF_ASCII_FIRST] in font units,
+// generated by scripts/ttf_embed.sh with scripts/kern_gen.c
+void TTF_set_kerning(struct TTF_t* state, const int16_t* ascii_kern);
+
+void TTF_set_arena(struct TTF_t* state, struct TTF_arena* arena);
+void TTF_arena_init(struct TTF_arena* arena, uint8_t* buf, int size);
+
+// glyphs used since the last call are protected from eviction
+void TTF_cache_begin(struct TTF_cache* cache);
+
+// single metrics pass, returns width or -1 if str is longer than TTF_RUN_MAX_GLYPHS
+int TTF_shape(struct TTF_t* state, struct TTF_run* run, const char* str, float line_height);
+int TTF_render_run(struct TTF_t* state, const struct TTF_run* run, float x, float y, int align);
+
 int TTF_render(struct TTF_t* state, const char* str, float x, float y, float line_height);
 int TTF_render_width(struct TTF_t* state, const char* str, float line_height);
 int TTF_render_centered(struct TTF_t* state, const char* str, float x, float y, float line_height);
 
+// only needs a canvas, returns -1 if str has chars missing from the atlas
+int TTF_atlas_render(struct TTF_t* state, const struct TTF_atlas* atlas, const char* str, float x, float y);
+int TTF_atlas_render_width(const struct TTF_atlas* atlas, const char* str);
+int TTF_atlas_render_centered(struct TTF_t* state, const struct TTF_atlas* atlas, const char* str, float x, float y);
+
 
 
 #ifdef __cplusplus
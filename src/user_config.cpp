@@ -2,6 +2,10 @@
 
 #include "user_config.hpp"
 
+#include "composite.h"
+#include "epd/epdif.h"
+#include "lut.hpp"
+
 #include <Preferences.h>
 
 
@@ -15,6 +19,15 @@ static const char*      KEY_PASSWORD            = "pass";
 static const char*      KEY_TIME_ZONE           = "tzus";
 static const char*      KEY_TIME_ZONE_ENABLED   = "tzon";
 static const char*      KEY_GREY_ENABLED        = "grey";
+static const char*      KEY_DITHER              = "dith";
+static const char*      KEY_WAVEFORM            = "wave";
+static const char*      KEY_SPI_MHZ             = "spi";
+static const char*      KEY_PARTIAL_LIMIT       = "plim";
+static const char*      KEY_FULL_REFRESH_MIN    = "fmin";
+
+static constexpr int    DEFAULT_SPI_MHZ         = SPI_CLOCK_HZ / 1000000;
+static constexpr int    DEFAULT_PARTIAL_LIMIT   = 10;
+static constexpr int    DEFAULT_FULL_REFRESH_MIN = 60;
 
 static char             ssid_buf[128]           = {};
 static char             password_buf[128]       = {};
@@ -47,12 +60,22 @@ int user_config_init()
 
     const bool time_zone_enabled = nvs.getBool(KEY_TIME_ZONE_ENABLED, (int64_t) false);
     const bool grey_enable = nvs.getBool(KEY_GREY_ENABLED, (int64_t) false);
+    const int dither = nvs.getUChar(KEY_DITHER, COMPOSITE_DITHER_NONE);
+    const int waveform = nvs.getUChar(KEY_WAVEFORM, WAVEFORM_STANDARD);
+    const int spi_mhz = nvs.getUChar(KEY_SPI_MHZ, DEFAULT_SPI_MHZ);
+    const int partial_limit = nvs.getUChar(KEY_PARTIAL_LIMIT, DEFAULT_PARTIAL_LIMIT);
+    const int full_refresh_min = nvs.getUShort(KEY_FULL_REFRESH_MIN, DEFAULT_FULL_REFRESH_MIN);
 
     user.ssid = ssid_buf;
     user.password = password_buf;
     user.time_zone = time_zone_buf;
     user.time_zone_enabled = time_zone_enabled;
     user.grey_enabled = grey_enable;
+    user.dither = dither;
+    user.waveform = waveform;
+    user.spi_mhz = spi_mhz;
+    user.partial_limit = partial_limit;
+    user.full_refresh_min = full_refresh_min;
     user.network_config_required = get_network_config_required();
     user.time_zone_config_required = get_time_zone_config_required();
     return 0;
@@ -123,6 +146,66 @@ int user_config_set_grey_enabled(bool enable)
     return 0;
 }
 
+int user_config_set_dither(int dither)
+{
+    user.dither = dither;
+
+    if (!nvs.putUChar(KEY_DITHER, (uint8_t) user.dither)) {
+        Serial.print("Error: NVS\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int user_config_set_waveform(int waveform)
+{
+    user.waveform = waveform;
+
+    if (!nvs.putUChar(KEY_WAVEFORM, (uint8_t) user.waveform)) {
+        Serial.print("Error: NVS\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int user_config_set_spi_mhz(int mhz)
+{
+    user.spi_mhz = mhz;
+
+    if (!nvs.putUChar(KEY_SPI_MHZ, (uint8_t) user.spi_mhz)) {
+        Serial.print("Error: NVS\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int user_config_set_partial_limit(int limit)
+{
+    user.partial_limit = limit;
+
+    if (!nvs.putUChar(KEY_PARTIAL_LIMIT, (uint8_t) user.partial_limit)) {
+        Serial.print("Error: NVS\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int user_config_set_full_refresh_min(int minutes)
+{
+    user.full_refresh_min = minutes;
+
+    if (!nvs.putUShort(KEY_FULL_REFRESH_MIN, (uint16_t) user.full_refresh_min)) {
+        Serial.print("Error: NVS\n");
+        return -1;
+    }
+
+    return 0;
+}
+
 int user_config_reset()
 {
     memset(ssid_buf, 0, sizeof(ssid_buf));
@@ -130,6 +213,11 @@ int user_config_reset()
     memset(time_zone_buf, 0, sizeof(time_zone_buf));
     user.time_zone_enabled = false;
     user.grey_enabled = false;
+    user.dither = COMPOSITE_DITHER_NONE;
+    user.waveform = WAVEFORM_STANDARD;
+    user.spi_mhz = DEFAULT_SPI_MHZ;
+    user.partial_limit = DEFAULT_PARTIAL_LIMIT;
+    user.full_refresh_min = DEFAULT_FULL_REFRESH_MIN;
     user.network_config_required = get_network_config_required();
     user.time_zone_config_required = get_time_zone_config_required();
     
@@ -14,6 +14,11 @@ struct UserConfig
     const char* time_zone;
     bool        time_zone_enabled;
     bool        grey_enabled;
+    int         dither;                 // COMPOSITE_DITHER_*, 2-color display only
+    int         waveform;               // WAVEFORM_*, 4-color display only
+    int         spi_mhz;                // panel write clock, self-tested before use
+    int         partial_limit;          // partial refreshes between whole frame ones, 0 for none
+    int         full_refresh_min;       // minutes between full quality refreshes, 0 for daily only
 
     bool        network_config_required;
     bool        time_zone_config_required;
@@ -29,6 +34,11 @@ int user_config_set_password(const char* password);
 int user_config_set_time_zone(const char* time_zone);
 int user_config_set_time_zone_enabled(bool enable);
 int user_config_set_grey_enabled(bool enable);
+int user_config_set_dither(int dither);
+int user_config_set_waveform(int waveform);
+int user_config_set_spi_mhz(int mhz);
+int user_config_set_partial_limit(int limit);
+int user_config_set_full_refresh_min(int minutes);
 
 } // namespace paper
 